@@ -0,0 +1,119 @@
+/*
+ * Пример встраивания ядра через C API: Солнце и Земля, один год шагами по суткам,
+ * затем то же с Луной в подсистеме Земли (суточный шаг для Луны иначе слишком груб).
+ * Заодно служит тестом (ctest): код возврата != 0 при ошибке.
+ */
+#include <stdio.h>
+#include <math.h>
+#include "SolarCore.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { fprintf(stderr, "FAILED: %s\n", msg); return 1; } } while (0)
+
+static double energy(const SolarEngine* engine) {
+    const double G = 6.67430e-11;
+    size_t n = solar_engine_body_count(engine);
+    const double* m = solar_engine_masses(engine);
+    const double* x = solar_engine_positions(engine);
+    const double* v = solar_engine_velocities(engine);
+    double e = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        e += 0.5 * m[i] * (v[3*i]*v[3*i] + v[3*i+1]*v[3*i+1] + v[3*i+2]*v[3*i+2]);
+        for (size_t j = i + 1; j < n; ++j) {
+            double dx = x[3*j] - x[3*i], dy = x[3*j+1] - x[3*i+1], dz = x[3*j+2] - x[3*i+2];
+            e -= G * m[i] * m[j] / sqrt(dx*dx + dy*dy + dz*dz);
+        }
+    }
+    return e;
+}
+
+int main(void) {
+    const double masses[2] = {1.989e30, 5.972e24};
+    const double positions[6] = {0, 0, 0,  1.496e11, 0, 0};
+    const double velocities[6] = {0, 0, 0,  0, 29780, 0};
+    const double day = 86400.0;
+
+    CHECK(solar_api_version() == SOLAR_API_VERSION, "ABI version mismatch");
+
+    SolarEngine* engine = solar_engine_create();
+    CHECK(engine != NULL, "create");
+    CHECK(solar_engine_add_bodies(engine, 2, masses, positions, velocities) == SOLAR_OK, "add bodies");
+    CHECK(solar_engine_add_bodies(engine, 1, NULL, positions, velocities) == SOLAR_ERROR_INVALID_ARGUMENT, "reject NULL masses");
+    CHECK(solar_engine_add_bodies(engine, (size_t)-1, masses, positions, velocities) == SOLAR_ERROR_INVALID_ARGUMENT, "reject count past INT_MAX");
+    CHECK(solar_engine_body_count(engine) == 2, "rejected add leaves bodies alone");
+    CHECK(solar_engine_set_integrator(engine, SOLAR_INTEGRATOR_RK4) == SOLAR_OK, "set integrator");
+
+    /* Указатели берутся один раз — шаги двигают данные на месте */
+    const double* x = solar_engine_positions(engine);
+    const double* a = solar_engine_accelerations(engine);
+    double e0 = energy(engine);
+
+    CHECK(solar_engine_step(engine, day, 365) == SOLAR_OK, "step");
+    CHECK(x == solar_engine_positions(engine), "positions pointer must stay stable across steps");
+    CHECK(fabs(solar_engine_time(engine) - 365 * day) < 1.0, "simulated time");
+
+    /* Через год Земля почти на месте (год ~365.25 сут, орбита почти круговая) */
+    double dx = x[3] - 1.496e11, dy = x[4];
+    double offset = sqrt(dx*dx + dy*dy);
+    double e1 = energy(engine);
+    double accel = sqrt(a[3]*a[3] + a[4]*a[4] + a[5]*a[5]);
+
+    printf("Earth after 365 days: (%.6e, %.6e) m, offset %.3e m\n", x[3], x[4], offset);
+    printf("Acceleration: %.6e m/s^2, relative energy drift: %.3e\n", accel, fabs((e1 - e0) / e0));
+
+    CHECK(offset < 0.01 * 1.496e11, "Earth should return close to its starting point");
+    CHECK(fabs(accel - 5.93e-3) < 1e-4, "solar acceleration at 1 AU");
+    CHECK(fabs((e1 - e0) / e0) < 1e-6, "energy conservation");
+
+    /* Verlet (по умолчанию) на свежем движке: первый полушаг берет a(t),
+     * которое ядро считает само, иначе орбита с первого шага эллиптическая */
+    SolarEngine* verlet = solar_engine_create();
+    CHECK(verlet != NULL, "create Verlet engine");
+    CHECK(solar_engine_add_bodies(verlet, 2, masses, positions, velocities) == SOLAR_OK, "add bodies (Verlet)");
+    CHECK(solar_engine_step(verlet, day, 365) == SOLAR_OK, "step (Verlet)");
+    {
+        const double mu = 6.67430e-11 * (masses[0] + masses[1]);
+        const double* p = solar_engine_positions(verlet);
+        const double* w = solar_engine_velocities(verlet);
+        double r[3], v[3], rv = 0.0, r2 = 0.0, v2 = 0.0, ecc = 0.0;
+        for (int k = 0; k < 3; ++k) {
+            r[k] = p[3 + k] - p[k];
+            v[k] = w[3 + k] - w[k];
+            rv += r[k] * v[k]; r2 += r[k] * r[k]; v2 += v[k] * v[k];
+        }
+        for (int k = 0; k < 3; ++k) {
+            double ek = (v2 / mu - 1.0 / sqrt(r2)) * r[k] - rv / mu * v[k];
+            ecc += ek * ek;
+        }
+        ecc = sqrt(ecc);
+        printf("Verlet: eccentricity after 365 days %.2e\n", ecc);
+        CHECK(ecc < 1e-3, "Verlet must start from the real acceleration, not zero");
+    }
+    solar_engine_destroy(verlet);
+
+    /* Луна: период 27 суток, интегрируется подшагами в системе Земли */
+    const double moon_mass = 7.342e22;
+    const double moon_position[3] = {1.496e11 + 3.844e8, 0, 0};
+    const double moon_velocity[3] = {0, 29780 + 1022, 0};
+    CHECK(solar_engine_clear(engine) == SOLAR_OK, "clear");
+    CHECK(solar_engine_add_bodies(engine, 2, masses, positions, velocities) == SOLAR_OK, "add bodies");
+    CHECK(solar_engine_add_bodies(engine, 1, &moon_mass, moon_position, moon_velocity) == SOLAR_OK, "add Moon");
+    CHECK(solar_engine_set_parent(engine, 2, 1) == SOLAR_OK, "Moon orbits Earth");
+    CHECK(solar_engine_set_parent(engine, 1, 2) == SOLAR_ERROR_INVALID_ARGUMENT, "reject nested subsystem");
+    CHECK(solar_engine_set_parent(engine, 5, 1) == SOLAR_ERROR_INVALID_ARGUMENT, "reject bad index");
+
+    x = solar_engine_positions(engine);
+    e0 = energy(engine);
+    CHECK(solar_engine_step(engine, day, 365) == SOLAR_OK, "step with Moon");
+    e1 = energy(engine);
+
+    double mx = x[6] - x[3], my = x[7] - x[4], mz = x[8] - x[5];
+    double moon_distance = sqrt(mx*mx + my*my + mz*mz);
+    printf("Earth-Moon distance after 365 days: %.4e m, relative energy drift: %.3e\n", moon_distance, fabs((e1 - e0) / e0));
+
+    CHECK(moon_distance > 3.6e8 && moon_distance < 4.1e8, "Moon should stay on its orbit");
+    CHECK(fabs((e1 - e0) / e0) < 1e-6, "energy conservation with a subsystem");
+
+    solar_engine_destroy(engine);
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "SolarCore.h"
+#include "../core/NBodyEngine.h"
+#include <new>
+#include <climits>
+
+// Непрозрачный дескриптор — просто движок ядра
+struct SolarEngine {
+    NBodyEngine engine;
+};
+
+// Eigen::Vector3d в std::vector — плотные тройки double, на этом держится zero-copy
+static_assert(sizeof(Eigen::Vector3d) == 3 * sizeof(double), "Eigen::Vector3d must be tightly packed");
+
+namespace {
+
+const double* flat(const std::vector<Eigen::Vector3d>& v) {
+    return v.empty() ? nullptr : v.data()->data();
+}
+
+} // namespace
+
+extern "C" {
+
+int solar_api_version(void) {
+    return SOLAR_API_VERSION;
+}
+
+SolarEngine* solar_engine_create(void) {
+    return new (std::nothrow) SolarEngine();
+}
+
+void solar_engine_destroy(SolarEngine* engine) {
+    delete engine;
+}
+
+SolarStatus solar_engine_add_bodies(SolarEngine* engine, size_t count,
+                                    const double* masses,
+                                    const double* positions,
+                                    const double* velocities) {
+    if (!engine || (count > 0 && (!masses || !positions || !velocities))) return SOLAR_ERROR_INVALID_ARGUMENT;
+
+    NBodyEngine& e = engine->engine;
+    const size_t first = e.masses.size();
+    if (count > (size_t)INT_MAX - first) return SOLAR_ERROR_INVALID_ARGUMENT; // Ядро индексирует тела int
+    try {
+        e.resize((int)(first + count));
+    } catch (const std::bad_alloc&) {
+        e.resize((int)first);
+        return SOLAR_ERROR_OUT_OF_MEMORY;
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+        e.masses[first + k] = masses[k];
+        e.positions[first + k] = Eigen::Vector3d(positions[3 * k], positions[3 * k + 1], positions[3 * k + 2]);
+        e.velocities[first + k] = Eigen::Vector3d(velocities[3 * k], velocities[3 * k + 1], velocities[3 * k + 2]);
+    }
+    return SOLAR_OK;
+}
+
+SolarStatus solar_engine_clear(SolarEngine* engine) {
+    if (!engine) return SOLAR_ERROR_INVALID_ARGUMENT;
+    engine->engine.clear();
+    return SOLAR_OK;
+}
+
+size_t solar_engine_body_count(const SolarEngine* engine) {
+    return engine ? engine->engine.masses.size() : 0;
+}
+
+SolarStatus solar_engine_set_integrator(SolarEngine* engine, SolarIntegrator integrator) {
+    if (!engine) return SOLAR_ERROR_INVALID_ARGUMENT;
+    switch (integrator) {
+    case SOLAR_INTEGRATOR_VERLET: engine->engine.currentIntegrator = IntegratorType::Verlet; break;
+    case SOLAR_INTEGRATOR_RK4: engine->engine.currentIntegrator = IntegratorType::RungeKutta4; break;
+    default: return SOLAR_ERROR_INVALID_ARGUMENT;
+    }
+    return SOLAR_OK;
+}
+
+SolarStatus solar_engine_set_relativity(SolarEngine* engine, int enabled) {
+    if (!engine) return SOLAR_ERROR_INVALID_ARGUMENT;
+    engine->engine.useRelativity = (enabled != 0);
+    return SOLAR_OK;
+}
+
+SolarStatus solar_engine_set_parent(SolarEngine* engine, size_t body, long parent) {
+    if (!engine || body > (size_t)INT_MAX || parent > (long)INT_MAX) return SOLAR_ERROR_INVALID_ARGUMENT;
+    return engine->engine.setParent((int)body, parent < 0 ? -1 : (int)parent) ? SOLAR_OK : SOLAR_ERROR_INVALID_ARGUMENT;
+}
+
+SolarStatus solar_engine_step(SolarEngine* engine, double dt, size_t steps) {
+    if (!engine || !std::isfinite(dt)) return SOLAR_ERROR_INVALID_ARGUMENT;
+    try {
+        for (size_t s = 0; s < steps; ++s) engine->engine.step(dt);
+    } catch (const std::bad_alloc&) {
+        return SOLAR_ERROR_OUT_OF_MEMORY;
+    }
+    return SOLAR_OK;
+}
+
+double solar_engine_time(const SolarEngine* engine) {
+    return engine ? engine->engine.time : 0.0;
+}
+
+const double* solar_engine_positions(const SolarEngine* engine) {
+    return engine ? flat(engine->engine.positions) : nullptr;
+}
+
+const double* solar_engine_velocities(const SolarEngine* engine) {
+    return engine ? flat(engine->engine.velocities) : nullptr;
+}
+
+const double* solar_engine_accelerations(const SolarEngine* engine) {
+    return engine ? flat(engine->engine.accelerations) : nullptr;
+}
+
+const double* solar_engine_masses(const SolarEngine* engine) {
+    return (engine && !engine->engine.masses.empty()) ? engine->engine.masses.data() : nullptr;
+}
+
+} // extern "C"
@@ -0,0 +1,92 @@
+#ifndef SOLAR_CORE_H
+#define SOLAR_CORE_H
+
+/*
+ * C API ядра симулятора (библиотека solar_core).
+ *
+ * Векторы передаются и возвращаются как плотные массивы double[3 * count]
+ * в порядке x0 y0 z0 x1 y1 z1 ... Массы — double[count], единицы СИ.
+ *
+ * Указатели из solar_engine_positions/velocities/accelerations смотрят
+ * прямо в состояние движка (без копирования). Они остаются валидными
+ * между шагами и меняются только после solar_engine_add_bodies,
+ * solar_engine_clear и solar_engine_destroy.
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(SOLAR_CORE_BUILD)
+#    define SOLAR_API __declspec(dllexport)
+#  else
+#    define SOLAR_API __declspec(dllimport)
+#  endif
+#else
+#  define SOLAR_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SOLAR_API_VERSION 1
+
+typedef struct SolarEngine SolarEngine;
+
+typedef enum SolarStatus {
+    SOLAR_OK = 0,
+    SOLAR_ERROR_INVALID_ARGUMENT = -1,
+    SOLAR_ERROR_OUT_OF_MEMORY = -2
+} SolarStatus;
+
+typedef enum SolarIntegrator {
+    SOLAR_INTEGRATOR_VERLET = 0,
+    SOLAR_INTEGRATOR_RK4 = 1
+} SolarIntegrator;
+
+/* Версия ABI, с которой собрана библиотека (сравнить с SOLAR_API_VERSION) */
+SOLAR_API int solar_api_version(void);
+
+/* NULL при нехватке памяти */
+SOLAR_API SolarEngine* solar_engine_create(void);
+SOLAR_API void solar_engine_destroy(SolarEngine* engine);
+
+/*
+ * Добавить count тел разом. Ускорения новых тел равны нулю до первого шага:
+ * первый шаг после add_bodies, set_parent или set_relativity сначала
+ * пересчитывает ускорения всех тел (Verlet начинает с a(t)).
+ * Всего тел не больше INT_MAX, иначе SOLAR_ERROR_INVALID_ARGUMENT.
+ */
+SOLAR_API SolarStatus solar_engine_add_bodies(SolarEngine* engine, size_t count,
+                                              const double* masses,
+                                              const double* positions,
+                                              const double* velocities);
+SOLAR_API SolarStatus solar_engine_clear(SolarEngine* engine);
+SOLAR_API size_t solar_engine_body_count(const SolarEngine* engine);
+
+SOLAR_API SolarStatus solar_engine_set_integrator(SolarEngine* engine, SolarIntegrator integrator);
+SOLAR_API SolarStatus solar_engine_set_relativity(SolarEngine* engine, int enabled);
+
+/*
+ * Спутник body интегрируется в системе отсчета parent со своими подшагами,
+ * снаружи подсистема — точечная масса в барицентре. parent = -1 отвязывает.
+ * Вложенность одна: у спутника не может быть своих спутников.
+ * Массивы состояния по-прежнему абсолютные.
+ */
+SOLAR_API SolarStatus solar_engine_set_parent(SolarEngine* engine, size_t body, long parent);
+
+/* steps шагов по dt секунд */
+SOLAR_API SolarStatus solar_engine_step(SolarEngine* engine, double dt, size_t steps);
+SOLAR_API double solar_engine_time(const SolarEngine* engine);
+
+/* Только чтение, double[3 * body_count]; NULL, если тел нет */
+SOLAR_API const double* solar_engine_positions(const SolarEngine* engine);
+SOLAR_API const double* solar_engine_velocities(const SolarEngine* engine);
+SOLAR_API const double* solar_engine_accelerations(const SolarEngine* engine);
+SOLAR_API const double* solar_engine_masses(const SolarEngine* engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOLAR_CORE_H */
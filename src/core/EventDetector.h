@@ -0,0 +1,444 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <initializer_list>
+#include <ostream>
+#include <Eigen/Dense>
+#include "NBodyEngine.h"
+
+// События между шагами: прохождения перицентра/апоцентра, минимумы расстояния
+// пары, тесные сближения любых тел, вход и выход из соединения (угловое
+// расстояние двух тел с точки зрения наблюдателя меньше порога).
+//
+// Между шагами состояние восстанавливается эрмитовым сплайном 5-й степени
+// по положению, скорости и ускорению на обоих концах (ускорения ядро и так
+// держит актуальными), момент события уточняется поиском корня (Illinois)
+// на этом сплайне — точнее шага в тысячи раз и без записи каждого шага.
+// Спутники подсистем делают за глобальный шаг много оборотов-долей: для них
+// сплайн строится в системе родителя по подшагам ядра (recordSubsteps),
+// а барицентр подсистемы — по концам глобального шага.
+
+enum class EventKind {
+    Periapsis,       // Минимум расстояния тела до центра
+    Apoapsis,        // Максимум
+    CloseApproach,   // Минимум расстояния пары меньше порога
+    ConjunctionStart,// Угловое расстояние стало меньше порога
+    ConjunctionEnd   // ...и снова больше
+};
+
+struct SimEvent {
+    EventKind kind;
+    double time;   // Модельное время, с
+    int body;      // Тело (для соединения — первая цель)
+    int other;     // Центр / второе тело пары / вторая цель
+    int observer;  // Наблюдатель соединения, иначе -1
+    double value;  // Расстояние, м, или угол, рад
+};
+
+inline const char* eventKindName(EventKind kind) {
+    switch (kind) {
+    case EventKind::Periapsis: return "periapsis";
+    case EventKind::Apoapsis: return "apoapsis";
+    case EventKind::CloseApproach: return "close approach";
+    case EventKind::ConjunctionStart: return "conjunction start";
+    case EventKind::ConjunctionEnd: return "conjunction end";
+    }
+    return "event";
+}
+
+class EventDetector {
+public:
+    // Куда писать события строкой (необязательно)
+    std::ostream* log = nullptr;
+
+    // --- РЕГИСТРАЦИЯ ПРЕДИКАТОВ ---
+    // Апсиды body относительно center (знак радиальной скорости)
+    void watchApsides(int body, int center) {
+        m_watches.push_back({Watch::Apsides, body, center, -1, 0.0});
+    }
+
+    // Минимум расстояния пары, если он меньше maxDistance
+    void watchPair(int a, int b, double maxDistance) {
+        m_watches.push_back({Watch::Pair, a, b, -1, maxDistance});
+    }
+
+    // Соединение a и b с точки зрения observer: угол меньше angle, рад
+    void watchSeparation(int observer, int a, int b, double angle) {
+        m_watches.push_back({Watch::Separation, a, b, observer, angle});
+    }
+
+    // Тесные сближения всех пар ближе distance (0 — выключено), с пространственным префильтром
+    void setCloseApproachDistance(double distance) { m_closeDistance = std::max(0.0, distance); }
+    double closeApproachDistance() const { return m_closeDistance; }
+
+    bool empty() const { return m_watches.empty() && m_closeDistance <= 0.0; }
+
+    void clear() {
+        m_watches.clear();
+        m_closeDistance = 0.0;
+        m_events.clear();
+    }
+
+    // Найденные события (в порядке времени внутри шага); забирает их вызывающий
+    std::vector<SimEvent> takeEvents() {
+        std::vector<SimEvent> out;
+        out.swap(m_events);
+        return out;
+    }
+
+    // Кандидатов тесных сближений на последнем шаге (для оценки префильтра)
+    int lastCandidatePairs() const { return m_lastCandidates; }
+
+    // --- ОБВЯЗКА ШАГА ---
+    // Ускорения engine должны соответствовать состоянию (NBodyEngine::updateAccelerations)
+    void beginStep(const NBodyEngine& engine) {
+        if (empty()) return;
+        m_t0 = engine.time;
+        m_p0 = engine.positions;
+        m_v0 = engine.velocities;
+        m_a0 = engine.accelerations;
+    }
+
+    void endStep(const NBodyEngine& engine) {
+        if (empty() || (int)m_p0.size() != engine.size()) return;
+        m_engine = &engine;
+        m_h = engine.time - m_t0;
+        if (m_h == 0.0) return;
+        bindTracks();
+
+        const size_t first = m_events.size();
+        for (auto& w : m_watches) {
+            if (!validIndex(w.a) || !validIndex(w.b) || (w.observer != -1 && !validIndex(w.observer))) continue;
+            if (w.type == Watch::Separation) checkSeparation(w);
+            else checkDistance(w.a, w.b, w.type == Watch::Apsides, w.limit);
+        }
+        if (m_closeDistance > 0.0) checkCloseApproaches();
+
+        std::sort(m_events.begin() + first, m_events.end(),
+                  [](const SimEvent& x, const SimEvent& y) { return x.time < y.time; });
+        if (log) {
+            for (size_t e = first; e < m_events.size(); ++e) writeEvent(*log, m_events[e]);
+        }
+        m_engine = nullptr;
+        m_views.clear();
+        m_trackOf.clear();
+    }
+
+    static void writeEvent(std::ostream& out, const SimEvent& e) {
+        out << "t=" << e.time << " s  " << eventKindName(e.kind) << "  body " << e.body << "  other " << e.other;
+        if (e.observer != -1) out << "  observer " << e.observer << "  angle " << e.value << " rad\n";
+        else out << "  distance " << e.value << " m\n";
+    }
+
+    // Эрмит 5-й степени на [0, 1] по p, v, a концов (h — длина шага)
+    static Eigen::Vector3d hermitePosition(const Eigen::Vector3d& p0, const Eigen::Vector3d& v0, const Eigen::Vector3d& a0,
+                                           const Eigen::Vector3d& p1, const Eigen::Vector3d& v1, const Eigen::Vector3d& a1,
+                                           double h, double s) {
+        const double s2 = s * s, s3 = s2 * s, s4 = s3 * s, s5 = s4 * s;
+        const double h0 = 1.0 - 10.0 * s3 + 15.0 * s4 - 6.0 * s5;
+        const double h1 = s - 6.0 * s3 + 8.0 * s4 - 3.0 * s5;
+        const double h2 = 0.5 * s2 - 1.5 * s3 + 1.5 * s4 - 0.5 * s5;
+        const double h3 = 0.5 * s3 - s4 + 0.5 * s5;
+        const double h4 = -4.0 * s3 + 7.0 * s4 - 3.0 * s5;
+        const double h5 = 10.0 * s3 - 15.0 * s4 + 6.0 * s5;
+        return h0 * p0 + h5 * p1 + h * (h1 * v0 + h4 * v1) + h * h * (h2 * a0 + h3 * a1);
+    }
+
+    static Eigen::Vector3d hermiteVelocity(const Eigen::Vector3d& p0, const Eigen::Vector3d& v0, const Eigen::Vector3d& a0,
+                                           const Eigen::Vector3d& p1, const Eigen::Vector3d& v1, const Eigen::Vector3d& a1,
+                                           double h, double s) {
+        const double s2 = s * s, s3 = s2 * s, s4 = s3 * s;
+        const double d0 = -30.0 * s2 + 60.0 * s3 - 30.0 * s4;
+        const double d1 = 1.0 - 18.0 * s2 + 32.0 * s3 - 15.0 * s4;
+        const double d2 = s - 4.5 * s2 + 6.0 * s3 - 2.5 * s4;
+        const double d3 = 1.5 * s2 - 4.0 * s3 + 2.5 * s4;
+        const double d4 = -12.0 * s2 + 28.0 * s3 - 15.0 * s4;
+        return (d0 * (p0 - p1)) / h + (d1 * v0 + d4 * v1) + h * (d2 * a0 + d3 * a1);
+    }
+
+private:
+    struct Watch {
+        enum Type { Apsides, Pair, Separation } type;
+        int a, b, observer;
+        double limit;
+    };
+
+    // Подынтервалов на шаг при поиске смены знака: ловит два события за шаг
+    static constexpr int kSamples = 4;
+    // Бокс тела, задевающий больше ячеек, уходит на более грубый уровень сетки
+    static constexpr int kMaxCellsPerBody = 64;
+    static constexpr int kMaxLevels = 16; // Ячейка до D * 4^15
+
+    std::vector<Watch> m_watches;
+    double m_closeDistance = 0.0;
+    std::vector<SimEvent> m_events;
+    int m_lastCandidates = 0;
+
+    // Состояние в начале шага
+    double m_t0 = 0.0;
+    double m_h = 0.0;
+    std::vector<Eigen::Vector3d> m_p0, m_v0, m_a0;
+    const NBodyEngine* m_engine = nullptr;
+
+    // Подсистема на время endStep: барицентр на концах шага и подшаги спутников
+    struct TrackView {
+        const NBodyEngine::SubstepTrack* track;
+        double total;
+        Eigen::Vector3d p0, v0, a0, p1, v1, a1;
+    };
+    std::vector<TrackView> m_views;
+    std::vector<int> m_trackOf; // Тело -> номер в m_views или -1
+
+    bool validIndex(int i) const { return i >= 0 && i < (int)m_p0.size(); }
+
+    void bindTracks() {
+        m_views.clear();
+        m_trackOf.clear();
+        const int n = (int)m_p0.size();
+        for (const auto& track : m_engine->substepTracks()) {
+            const int k = (int)track.members.size();
+            if (track.substeps < 1 || (int)track.pos.size() != (track.substeps + 1) * k || !validIndex(track.parent)) continue;
+            TrackView view{&track, 0.0, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(),
+                           Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero()};
+            bool valid = true;
+            for (int m = -1; m < k; ++m) {
+                const int i = (m < 0) ? track.parent : track.members[m];
+                if (!validIndex(i)) { valid = false; break; }
+                const double mass = m_engine->masses[i];
+                view.total += mass;
+                view.p0 += mass * m_p0[i]; view.v0 += mass * m_v0[i]; view.a0 += mass * m_a0[i];
+                view.p1 += mass * m_engine->positions[i]; view.v1 += mass * m_engine->velocities[i];
+                view.a1 += mass * m_engine->accelerations[i];
+            }
+            if (!valid || view.total <= 0.0) continue;
+            for (Eigen::Vector3d* x : {&view.p0, &view.v0, &view.a0, &view.p1, &view.v1, &view.a1}) *x /= view.total;
+
+            if (m_trackOf.empty()) m_trackOf.assign(n, -1);
+            m_trackOf[track.parent] = (int)m_views.size();
+            for (int i : track.members) m_trackOf[i] = (int)m_views.size();
+            m_views.push_back(view);
+        }
+    }
+
+    int trackOf(int i) const { return (i < 0 || m_trackOf.empty()) ? -1 : m_trackOf[i]; }
+
+    // Тело подсистемы: барицентр + (свое локальное положение - сдвиг родителя
+    // к барицентру); локальные — эрмит между соседними подшагами
+    void trackState(int i, double s, Eigen::Vector3d& p, Eigen::Vector3d& v) const {
+        const TrackView& view = m_views[m_trackOf[i]];
+        const NBodyEngine::SubstepTrack& track = *view.track;
+        const int k = (int)track.members.size();
+        const int seg = std::clamp((int)std::floor(s * track.substeps), 0, track.substeps - 1);
+        const double u = s * track.substeps - seg;
+        const double hk = m_h / track.substeps;
+
+        Eigen::Vector3d shiftP = Eigen::Vector3d::Zero(), shiftV = Eigen::Vector3d::Zero();
+        Eigen::Vector3d ownP = Eigen::Vector3d::Zero(), ownV = Eigen::Vector3d::Zero();
+        for (int m = 0; m < k; ++m) {
+            const size_t a = (size_t)seg * k + m, b = a + k;
+            const Eigen::Vector3d lp = hermitePosition(track.pos[a], track.vel[a], track.acc[a], track.pos[b], track.vel[b], track.acc[b], hk, u);
+            const Eigen::Vector3d lv = hermiteVelocity(track.pos[a], track.vel[a], track.acc[a], track.pos[b], track.vel[b], track.acc[b], hk, u);
+            const double mass = m_engine->masses[track.members[m]];
+            shiftP += mass * lp;
+            shiftV += mass * lv;
+            if (track.members[m] == i) { ownP = lp; ownV = lv; }
+        }
+        p = hermitePosition(view.p0, view.v0, view.a0, view.p1, view.v1, view.a1, m_h, s) - shiftP / view.total + ownP;
+        v = hermiteVelocity(view.p0, view.v0, view.a0, view.p1, view.v1, view.a1, m_h, s) - shiftV / view.total + ownV;
+    }
+
+    Eigen::Vector3d pos(int i, double s) const {
+        if (trackOf(i) >= 0) {
+            Eigen::Vector3d p, v;
+            trackState(i, s, p, v);
+            return p;
+        }
+        return hermitePosition(m_p0[i], m_v0[i], m_a0[i], m_engine->positions[i], m_engine->velocities[i],
+                               m_engine->accelerations[i], m_h, s);
+    }
+
+    Eigen::Vector3d vel(int i, double s) const {
+        if (trackOf(i) >= 0) {
+            Eigen::Vector3d p, v;
+            trackState(i, s, p, v);
+            return v;
+        }
+        return hermiteVelocity(m_p0[i], m_v0[i], m_a0[i], m_engine->positions[i], m_engine->velocities[i],
+                               m_engine->accelerations[i], m_h, s);
+    }
+
+    // Подынтервалов поиска: не меньше kSamples и не меньше подшагов подсистем участников
+    int samplesFor(std::initializer_list<int> bodies) const {
+        int samples = kSamples;
+        for (int i : bodies)
+            if (trackOf(i) >= 0) samples = std::max(samples, m_views[trackOf(i)].track->substeps);
+        return samples;
+    }
+
+    // Корень f на [s0, s1] при смене знака: Illinois (регула фальси без застревания)
+    template <typename F>
+    static double findRoot(F f, double s0, double f0, double s1, double f1) {
+        int side = 0;
+        for (int it = 0; it < 100 && std::abs(s1 - s0) > 1e-13; ++it) {
+            double s = (s0 * f1 - s1 * f0) / (f1 - f0);
+            if (!(s > s0 && s < s1)) s = 0.5 * (s0 + s1);
+            const double fs = f(s);
+            if (fs == 0.0) return s;
+            if ((fs > 0.0) == (f1 > 0.0)) {
+                s1 = s; f1 = fs;
+                if (side == 1) f0 *= 0.5;
+                side = 1;
+            } else {
+                s0 = s; f0 = fs;
+                if (side == -1) f1 *= 0.5;
+                side = -1;
+            }
+        }
+        return 0.5 * (s0 + s1);
+    }
+
+    // Экстремумы расстояния a–b: корни (r_ab . v_ab)
+    void checkDistance(int a, int b, bool apsides, double limit) {
+        auto f = [&](double s) { return (pos(a, s) - pos(b, s)).dot(vel(a, s) - vel(b, s)); };
+
+        const int samples = samplesFor({a, b});
+        double s0 = 0.0, f0 = (m_p0[a] - m_p0[b]).dot(m_v0[a] - m_v0[b]);
+        for (int k = 1; k <= samples; ++k) {
+            const double s1 = (double)k / samples;
+            const double f1 = (k == samples)
+                ? (m_engine->positions[a] - m_engine->positions[b]).dot(m_engine->velocities[a] - m_engine->velocities[b])
+                : f(s1);
+            // Событие — в (s0, s1]: смена знака, корень в конце считается один раз
+            if ((f0 < 0.0 && f1 >= 0.0) || (f0 > 0.0 && f1 <= 0.0)) {
+                const bool minimum = (f0 < 0.0);
+                const double s = (f1 == 0.0) ? s1 : findRoot(f, s0, f0, s1, f1);
+                const double distance = (pos(a, s) - pos(b, s)).norm();
+                if (apsides) {
+                    emit(minimum ? EventKind::Periapsis : EventKind::Apoapsis, s, a, b, -1, distance);
+                } else if (minimum && distance < limit) {
+                    emit(EventKind::CloseApproach, s, a, b, -1, distance);
+                }
+            }
+            s0 = s1; f0 = f1;
+        }
+    }
+
+    double separation(const Watch& w, double s) const {
+        const Eigen::Vector3d o = pos(w.observer, s);
+        const Eigen::Vector3d da = pos(w.a, s) - o, db = pos(w.b, s) - o;
+        return std::atan2(da.cross(db).norm(), da.dot(db));
+    }
+
+    void checkSeparation(const Watch& w) {
+        auto f = [&](double s) { return separation(w, s) - w.limit; };
+        const int samples = samplesFor({w.a, w.b, w.observer});
+        double s0 = 0.0, f0 = f(0.0);
+        for (int k = 1; k <= samples; ++k) {
+            const double s1 = (double)k / samples;
+            const double f1 = f(s1);
+            if ((f0 > 0.0 && f1 <= 0.0) || (f0 < 0.0 && f1 >= 0.0)) {
+                const double s = (f1 == 0.0) ? s1 : findRoot(f, s0, f0, s1, f1);
+                emit(f0 > 0.0 ? EventKind::ConjunctionStart : EventKind::ConjunctionEnd, s, w.a, w.b, w.observer, w.limit);
+            }
+            s0 = s1; f0 = f1;
+        }
+    }
+
+    // Префильтр: пройденный за шаг отрезок тела, раздутый на D/2, в иерархии
+    // сеток с ячейкой ~D * 4^L. Тело ложится на самый мелкий уровень, где его
+    // бокс задевает не больше kMaxCellsPerBody ячеек (быстрые планеты — выше),
+    // и дополнительно "спрашивает" все более грубые занятые уровни. Кандидаты —
+    // тела с общей ячейкой уровня; пары без общей ячейки не могут сблизиться
+    // меньше чем на D. Ключи сортируются — без хеш-таблиц.
+    void checkCloseApproaches() {
+        const int n = (int)m_p0.size();
+        const double D = m_closeDistance;
+
+        double meanDisp = 0.0;
+        for (int i = 0; i < n; ++i) meanDisp += (m_engine->positions[i] - m_p0[i]).norm();
+        meanDisp /= std::max(1, n);
+        const double baseCell = std::max(D, meanDisp);
+
+        // Боксы и уровни
+        std::vector<Eigen::Vector3d> lo(n), hi(n);
+        std::vector<int> level(n, 0);
+        uint32_t occupied = 0; // Битовая маска занятых уровней
+        for (int i = 0; i < n; ++i) {
+            // Запас на кривизну: отклонение дуги от хорды не больше |a| h^2 / 8
+            const Eigen::Vector3d p0 = m_p0[i], p1 = m_engine->positions[i];
+            const double accel = std::max(m_a0[i].norm(), m_engine->accelerations[i].norm());
+            const double pad = 0.5 * D + 0.125 * accel * m_h * m_h;
+            lo[i] = p0.cwiseMin(p1).array() - pad;
+            hi[i] = p0.cwiseMax(p1).array() + pad;
+            while (level[i] < kMaxLevels - 1 && cellSpan(lo[i], hi[i], levelCell(baseCell, level[i])) > kMaxCellsPerBody) ++level[i];
+            occupied |= 1u << level[i];
+        }
+
+        // (уровень, ячейка, тело, владелец): владелец — на своем уровне, запрос — на более грубых
+        struct Entry { int level; uint64_t key; int body; bool owner; };
+        std::vector<Entry> entries;
+        entries.reserve(n);
+        auto insert = [&](int i, int L, bool owner) {
+            const double cell = levelCell(baseCell, L);
+            const Eigen::Vector3d c0 = (lo[i] / cell).array().floor(), c1 = (hi[i] / cell).array().floor();
+            for (double x = c0.x(); x <= c1.x(); ++x)
+                for (double y = c0.y(); y <= c1.y(); ++y)
+                    for (double z = c0.z(); z <= c1.z(); ++z)
+                        entries.push_back({L, cellKey(x, y, z), i, owner});
+        };
+        for (int i = 0; i < n; ++i) {
+            insert(i, level[i], true);
+            for (int L = level[i] + 1; L < kMaxLevels; ++L)
+                if (occupied & (1u << L)) insert(i, L, false);
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry& x, const Entry& y) {
+            if (x.level != y.level) return x.level < y.level;
+            if (x.key != y.key) return x.key < y.key;
+            return x.owner > y.owner;
+        });
+        auto sameCell = [&](size_t u, size_t v) { return entries[u].level == entries[v].level && entries[u].key == entries[v].key; };
+
+        std::vector<uint64_t> pairs;
+        for (size_t r = 0; r < entries.size();) {
+            size_t e = r, owners = r;
+            while (e < entries.size() && sameCell(e, r)) ++e;
+            while (owners < e && entries[owners].owner) ++owners;
+            // Владельцы между собой и с запросами; запросы между собой встретятся на своих уровнях
+            for (size_t u = r; u < owners; ++u)
+                for (size_t v = u + 1; v < e; ++v)
+                    pairs.push_back(pairKey(entries[u].body, entries[v].body));
+            r = e;
+        }
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+        m_lastCandidates = (int)pairs.size();
+
+        for (uint64_t key : pairs) {
+            checkDistance((int)(key >> 32), (int)(key & 0xffffffffu), false, D);
+        }
+    }
+
+    static double levelCell(double base, int level) { return std::ldexp(base, 2 * level); } // base * 4^level
+
+    static double cellSpan(const Eigen::Vector3d& lo, const Eigen::Vector3d& hi, double cell) {
+        const Eigen::Vector3d c0 = (lo / cell).array().floor(), c1 = (hi / cell).array().floor();
+        return (c1 - c0 + Eigen::Vector3d::Ones()).prod();
+    }
+
+    static uint64_t cellKey(double x, double y, double z) {
+        auto part = [](double c) { return (uint64_t)((int64_t)c + (1 << 20)) & 0x1fffffu; };
+        return (part(x) << 42) | (part(y) << 21) | part(z);
+    }
+
+    static uint64_t pairKey(int i, int j) {
+        if (i > j) std::swap(i, j);
+        return ((uint64_t)i << 32) | (uint32_t)j;
+    }
+
+    void emit(EventKind kind, double s, int body, int other, int observer, double value) {
+        m_events.push_back({kind, m_t0 + s * m_h, body, other, observer, value});
+    }
+};
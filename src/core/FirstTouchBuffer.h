@@ -0,0 +1,47 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+// Буфер без инициализации при выделении памяти.
+// std::vector<double>::resize обнуляет память в вызывающем потоке, и на
+// многосокетной машине все страницы оказываются на узле главного потока.
+// Здесь память не трогается до первой записи, поэтому страница попадает
+// на NUMA-узел того потока, который первым в неё пишет (first-touch).
+// Копия — обычная поэлементная в вызывающем потоке: NBodyEngine и PhysicsEngine
+// остаются копируемыми, а размещение по узлам копия заново получает при
+// следующем изменении числа тел.
+template <typename T>
+class FirstTouchBuffer {
+public:
+    FirstTouchBuffer() = default;
+    FirstTouchBuffer(FirstTouchBuffer&&) noexcept = default;
+    FirstTouchBuffer& operator=(FirstTouchBuffer&&) noexcept = default;
+
+    FirstTouchBuffer(const FirstTouchBuffer& other) { *this = other; }
+
+    FirstTouchBuffer& operator=(const FirstTouchBuffer& other) {
+        if (this == &other) return *this;
+        resize(other.m_size);
+        std::copy(other.m_data.get(), other.m_data.get() + other.m_size, m_data.get());
+        return *this;
+    }
+
+    void resize(size_t n) {
+        if (n == m_size) return;
+        m_data.reset(n ? new T[n] : nullptr); // default-init: без записи в память
+        m_size = n;
+    }
+
+    size_t size() const { return m_size; }
+
+    T* data() { return m_data.get(); }
+    const T* data() const { return m_data.get(); }
+
+    T& operator[](size_t i) { return m_data[i]; }
+    const T& operator[](size_t i) const { return m_data[i]; }
+
+private:
+    std::unique_ptr<T[]> m_data;
+    size_t m_size = 0;
+};
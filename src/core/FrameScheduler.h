@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <algorithm>
+
+// Итог одного кадра
+struct FrameReport {
+    int substeps = 0;          // Сколько шагов интегратора сделано
+    double simulated = 0.0;    // Сколько модельного времени пройдено, с
+    double requested = 0.0;    // Сколько требовалось (накопитель + запрос кадра), с
+    double dropped = 0.0;      // Сколько отброшено, чтобы не копить отставание, с
+    double wallSeconds = 0.0;  // Реальное время, потраченное на шаги
+    bool behind = false;       // Бюджет кончился раньше, чем модельное время
+};
+
+// Фиксированный шаг с накопителем: скорость симуляции задает число шагов
+// за кадр, а не размер dt. Шаги идут, пока хватает бюджета реального времени
+// кадра; недоделанное остается в накопителе, но не больше одного кадра,
+// иначе отставание растет без предела ("spiral of death").
+class FrameScheduler {
+public:
+    double fixedStep = 3600.0 * 24;  // dt интегратора, с
+    double frameBudget = 0.012;      // Бюджет на физику за кадр, с
+
+    void reset() {
+        m_accumulator = 0.0;
+        m_stepCost = 0.0;
+    }
+
+    // simSeconds — модельное время, которое "положено" пройти за этот кадр
+    template <typename Engine>
+    FrameReport advance(Engine& engine, double simSeconds) {
+        using Clock = std::chrono::steady_clock;
+        FrameReport report;
+
+        m_accumulator += std::max(0.0, simSeconds);
+        report.requested = m_accumulator;
+
+        const auto start = Clock::now();
+        while (m_accumulator >= fixedStep) {
+            // Не начинаем шаг, который по оценке не влезет в бюджет
+            if (report.substeps > 0 && report.wallSeconds + m_stepCost > frameBudget) {
+                report.behind = true;
+                break;
+            }
+
+            const auto t0 = Clock::now();
+            engine.step(fixedStep);
+            const double cost = std::chrono::duration<double>(Clock::now() - t0).count();
+
+            // Скользящее среднее цены шага
+            m_stepCost = (m_stepCost == 0.0) ? cost : 0.8 * m_stepCost + 0.2 * cost;
+            m_accumulator -= fixedStep;
+            report.simulated += fixedStep;
+            report.substeps++;
+            report.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        // Хвост меньше шага переносится; отставание — максимум на кадр вперед
+        const double maxCarry = std::max(fixedStep, simSeconds);
+        if (m_accumulator > maxCarry) {
+            report.dropped = m_accumulator - maxCarry;
+            m_accumulator = maxCarry;
+        }
+        return report;
+    }
+
+    double accumulator() const { return m_accumulator; }
+
+private:
+    double m_accumulator = 0.0;
+    double m_stepCost = 0.0;
+};
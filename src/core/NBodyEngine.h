@@ -0,0 +1,700 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <omp.h>
+#include <Eigen/Dense>
+#include "FirstTouchBuffer.h"
+
+// Один параллельный регион на весь шаг. proc_bind(spread) разносит потоки
+// по ядрам обоих сокетов и закрепляет их, чтобы first-touch размещение
+// буферов не ломалось миграцией потоков (нужен OpenMP 4.0+).
+#if defined(_OPENMP) && _OPENMP >= 201307
+#define SOLAR_OMP_STEP_REGION _Pragma("omp parallel proc_bind(spread) if(n >= kParallelMinBodies)")
+#else
+#define SOLAR_OMP_STEP_REGION _Pragma("omp parallel if(n >= kParallelMinBodies)")
+#endif
+
+enum class IntegratorType {
+    Verlet,
+    RungeKutta4
+};
+
+// Вычислительное ядро без Qt: состояние хранится в непрерывных массивах.
+// std::vector<Eigen::Vector3d> лежит в памяти как x0 y0 z0 x1 y1 z1 ...,
+// поэтому positions.data()->data() — это готовый double[3N] без копирования.
+class NBodyEngine {
+public:
+    static constexpr double G = 6.67430e-11;
+    static constexpr double C = 299792458.0;
+
+    std::vector<double> masses;
+    std::vector<Eigen::Vector3d> positions;
+    std::vector<Eigen::Vector3d> velocities;
+    std::vector<Eigen::Vector3d> accelerations;
+
+    IntegratorType currentIntegrator = IntegratorType::Verlet;
+    bool useRelativity = false;
+
+    // Шагов локального интегратора на самый короткий период спутника подсистемы
+    int subsystemStepsPerOrbit = 32;
+
+    // Сохранять подшаги спутников за step() (нужно событиям между шагами)
+    bool recordSubsteps = false;
+
+    // Подшаги подсистемы за последний step(): состояния спутников относительно
+    // родителя в substeps + 1 равноотстоящих точках (0, dt/substeps, ..., dt),
+    // строка на точку, в строке — по спутнику в порядке members
+    struct SubstepTrack {
+        int parent = -1;
+        std::vector<int> members;
+        int substeps = 0;
+        std::vector<Eigen::Vector3d> pos, vel, acc;
+    };
+
+    double time = 0.0; // Модельное время с начала, с
+
+    int size() const { return (int)masses.size(); }
+
+    void addBody(double mass, const Eigen::Vector3d& pos, const Eigen::Vector3d& vel) {
+        m_accelerationsValid = false;
+        masses.push_back(mass);
+        positions.push_back(pos);
+        velocities.push_back(vel);
+        accelerations.push_back(Eigen::Vector3d::Zero());
+    }
+
+    void resize(int n) {
+        m_accelerationsValid = false;
+        masses.resize(n, 0.0);
+        placeBodyArrays(n);
+
+        // Подсистемы с исчезнувшими телами распускаем
+        for (auto& sub : m_subsystems) {
+            auto gone = [n](int m) { return m >= n; };
+            sub.members.erase(std::remove_if(sub.members.begin(), sub.members.end(), gone), sub.members.end());
+            sub.synced = false;
+        }
+        m_subsystems.erase(std::remove_if(m_subsystems.begin(), m_subsystems.end(),
+            [n](const Subsystem& sub) { return sub.parent >= n || sub.members.empty(); }), m_subsystems.end());
+    }
+
+    void clear() {
+        resize(0);
+        m_subsystems.clear();
+        time = 0.0;
+    }
+
+    // --- ИЕРАРХИЧЕСКИЕ ПОДСИСТЕМЫ (планета + спутники) ---
+    // Спутник body движется в системе отсчета parent со своими подшагами, а
+    // снаружи подсистема видна как одна точечная масса в ее барицентре —
+    // глобальный dt не зависит от периодов спутников. Массивы positions/velocities
+    // остаются абсолютными; parent = -1 возвращает тело в общий интегратор.
+    bool setParent(int body, int parent) {
+        const int n = size();
+        if (body < 0 || body >= n || parent >= n || body == parent) return false;
+        if (parent >= 0 && (parentOf(parent) != -1 || findSubsystem(body) != -1)) return false; // Только один уровень
+        m_accelerationsValid = false;
+
+        // Отвязываем от прежней подсистемы (абсолютное состояние уже актуально)
+        for (int b = 0; b < (int)m_subsystems.size(); ++b) {
+            auto& members = m_subsystems[b].members;
+            auto it = std::find(members.begin(), members.end(), body);
+            if (it == members.end()) continue;
+            members.erase(it);
+            m_subsystems[b].synced = false;
+            if (members.empty()) m_subsystems.erase(m_subsystems.begin() + b);
+            break;
+        }
+        if (parent < 0) return true;
+
+        int b = findSubsystem(parent);
+        if (b == -1) {
+            m_subsystems.emplace_back();
+            m_subsystems.back().parent = parent;
+            b = (int)m_subsystems.size() - 1;
+        }
+        m_subsystems[b].members.push_back(body);
+        m_subsystems[b].synced = false;
+        return true;
+    }
+
+    int parentOf(int body) const {
+        for (const auto& sub : m_subsystems) {
+            if (std::find(sub.members.begin(), sub.members.end(), body) != sub.members.end()) return sub.parent;
+        }
+        return -1;
+    }
+
+    int subsystemCount() const { return (int)m_subsystems.size(); }
+
+    // Пусто, если recordSubsteps выключен или подсистем нет
+    const std::vector<SubstepTrack>& substepTracks() const { return m_tracks; }
+
+    // --- УСКОРЕНИЯ ПЕРВОГО ШАГА ---
+    // Verlet начинает шаг с a(t) из accelerations. После addBody, resize,
+    // setParent или смены useRelativity там нули или устаревшие значения —
+    // step() сам пересчитает их. Кто правит массивы состояния напрямую
+    // (загрузка, перенос из вековой теории), сообщает об этом здесь.
+    void invalidateAccelerations() { m_accelerationsValid = false; }
+    bool accelerationsValid() const { return m_accelerationsValid && m_accRelativity == useRelativity; }
+
+    // Ускорения для текущего состояния без шага
+    void updateAccelerations() {
+        const int n = size();
+        if (m_placed != n) placeBodyArrays(n);
+        prepareBuffers(n);
+        beginSubsystems();
+
+        SOLAR_OMP_STEP_REGION
+        {
+            computeAccelerationsForState();
+        }
+        for (auto& sub : m_subsystems) {
+            sub.baryAcc = accelerations[sub.parent];
+            sub.hasBaryAcc = true;
+            localAccelerations(sub, sub.tidalStart, sub.localAcc);
+            writeAbsolute(sub);
+        }
+        m_accelerationsValid = true;
+        m_accRelativity = useRelativity;
+    }
+
+    void step(double dt) {
+        if (!accelerationsValid()) updateAccelerations();
+        const int n = size();
+        if (m_placed != n) placeBodyArrays(n); // После addBody
+        prepareBuffers(n);
+        beginSubsystems();
+
+        // Все циклы внутри — orphaned-циклы по "своим" индексам потока
+        SOLAR_OMP_STEP_REGION
+        {
+            if (currentIntegrator == IntegratorType::Verlet) {
+                stepVerlet(dt);
+            } else {
+                stepRK4(dt);
+            }
+        }
+        endSubsystems(dt);
+        time += dt;
+        m_accelerationsValid = true; // Оба интегратора заканчивают шаг расчетом a(t+dt)
+    }
+
+private:
+    // --- ПАРАМЕТРЫ ТАЙЛИНГА ---
+    // i-блок: аккумуляторы 64 тел (1.5 КБ) живут в L1.
+    // j-блок: 512 тел * 4 double = 16 КБ SoA, помещается в L1 и
+    // переиспользуется всеми i блока вместо потока по всему массиву.
+    static constexpr int kTileI = 64;
+    static constexpr int kTileJ = 512;
+    // Для маленьких систем накладные расходы потоков больше самой работы
+    static constexpr int kParallelMinBodies = 256;
+    // Защита от столкновений (мягкое ядро), r^2 в м^2
+    static constexpr double kMinDist2 = 1e10;
+    static constexpr double kTwoPi = 6.283185307179586;
+
+    struct State {
+        Eigen::Vector3d pos;
+        Eigen::Vector3d vel;
+
+        // Пустой конструктор: resize не обнуляет буфер в главном потоке
+        State() {}
+        State(const Eigen::Vector3d& p, const Eigen::Vector3d& v) : pos(p), vel(v) {}
+    };
+
+    // --- БУФЕРЫ ПАМЯТИ ---
+    // Разделяем буферы, чтобы старые данные не перезаписывались новыми
+    std::vector<Eigen::Vector3d> m_accBuffer;     // Для расчета текущих сил
+    std::vector<Eigen::Vector3d> m_oldAccBuffer;  // Специально для Verlet (хранит a(t))
+
+    // Буферы для RK4
+    std::vector<State> m_stateBuffer;
+    std::vector<Eigen::Vector3d> m_kAccBuffer;
+    std::vector<Eigen::Vector3d> m_sumX;          // sum(w * k_x)
+    std::vector<Eigen::Vector3d> m_sumV;          // sum(w * k_v)
+
+    // Упакованные координаты и G*m для ядра (SoA)
+    FirstTouchBuffer<double> m_px, m_py, m_pz, m_gm;
+
+    struct Subsystem {
+        int parent = -1;
+        std::vector<int> members;
+
+        // Состояние спутников относительно родителя — основное, абсолютное из него выводится
+        std::vector<Eigen::Vector3d> localPos, localVel, localAcc;
+        bool synced = false;
+
+        // Ускорение барицентра для Verlet (в слоте родителя лежит ускорение планеты)
+        Eigen::Vector3d baryAcc = Eigen::Vector3d::Zero();
+        bool hasBaryAcc = false;
+
+        Eigen::Matrix3d tidalStart = Eigen::Matrix3d::Zero();
+
+        // Что ядро записало в общие массивы: по расхождению видно правку извне
+        std::vector<Eigen::Vector3d> writtenPos, writtenVel;
+        std::vector<double> writtenMass;
+    };
+    std::vector<Subsystem> m_subsystems;
+    std::vector<SubstepTrack> m_tracks;
+
+    bool m_accelerationsValid = false;
+    bool m_accRelativity = false; // useRelativity, с которым они посчитаны
+
+    // Массы для расчета сил: родитель несет всю подсистему, спутники — ноль
+    std::vector<double> m_effMass;
+    const double* m_massSource = nullptr;
+
+    // Тела общего ядра по возрастанию (без спутников подсистем); пусто — все.
+    // Спутник снаружи не виден, а его ускорение пишет writeAbsolute, поэтому
+    // в O(N^2) он не участвует ни как источник, ни как получатель
+    std::vector<int> m_global;
+    std::vector<char> m_isMoon;
+
+    // --- РАЗМЕЩЕНИЕ МАССИВОВ ТЕЛ ---
+    // positions/velocities/accelerations растут в главном потоке (push_back,
+    // resize со значением), и все их страницы оказались бы на его узле. При
+    // смене размера перекладываем их в свежую память: каждый поток копирует
+    // свой диапазон ownedRange, и страница достается узлу, который потом с ней
+    // работает. Массы остаются как есть — за шаг они читаются один раз в m_gm.
+    int m_placed = 0;
+
+    void placeBodyArrays(int n) {
+        const int kept = std::min((int)positions.size(), n);
+        m_placed = n;
+        if (n < kParallelMinBodies) {
+            positions.resize(n, Eigen::Vector3d::Zero());
+            velocities.resize(n, Eigen::Vector3d::Zero());
+            accelerations.resize(n, Eigen::Vector3d::Zero());
+            return;
+        }
+
+        // Vector3d без инициализации: resize(n) не трогает страниц
+        std::vector<Eigen::Vector3d> pos, vel, acc;
+        pos.resize(n); vel.resize(n); acc.resize(n);
+        SOLAR_OMP_STEP_REGION
+        {
+            int begin, end;
+            ownedRange(n, begin, end);
+            for (int i = begin; i < end; ++i) {
+                if (i < kept) {
+                    pos[i] = positions[i];
+                    vel[i] = velocities[i];
+                    acc[i] = accelerations[i];
+                } else {
+                    pos[i].setZero(); vel[i].setZero(); acc[i].setZero();
+                }
+            }
+        }
+        positions.swap(pos);
+        velocities.swap(vel);
+        accelerations.swap(acc);
+    }
+
+    // Выделяем память до входа в параллельный регион. Страницы
+    // не трогаются здесь — их первым запишет поток-владелец индексов.
+    void prepareBuffers(int n) {
+        if ((int)m_accBuffer.size() != n) m_accBuffer.resize(n);
+        if ((int)m_oldAccBuffer.size() != n) m_oldAccBuffer.resize(n);
+        if ((int)m_stateBuffer.size() != n) m_stateBuffer.resize(n);
+        if ((int)m_kAccBuffer.size() != n) m_kAccBuffer.resize(n);
+        if ((int)m_sumX.size() != n) m_sumX.resize(n);
+        if ((int)m_sumV.size() != n) m_sumV.resize(n);
+        m_px.resize(n); m_py.resize(n); m_pz.resize(n); m_gm.resize(n);
+
+        m_global.clear();
+        if (m_subsystems.empty()) {
+            m_massSource = masses.data();
+        } else {
+            m_effMass = masses;
+            m_massSource = m_effMass.data();
+
+            m_isMoon.assign(n, 0);
+            for (const auto& sub : m_subsystems)
+                for (int m : sub.members) m_isMoon[m] = 1;
+            for (int i = 0; i < n; ++i) if (!m_isMoon[i]) m_global.push_back(i);
+        }
+    }
+
+    int findSubsystem(int parent) const {
+        for (int b = 0; b < (int)m_subsystems.size(); ++b) if (m_subsystems[b].parent == parent) return b;
+        return -1;
+    }
+
+    // Абсолютное состояние подсистемы менялось не ядром (загрузка, C API, правка тела)?
+    bool changedOutside(const Subsystem& sub) const {
+        if (!sub.synced) return true;
+        for (int k = 0; k <= (int)sub.members.size(); ++k) {
+            const int i = (k == 0) ? sub.parent : sub.members[k - 1];
+            if (positions[i] != sub.writtenPos[k] || velocities[i] != sub.writtenVel[k] || masses[i] != sub.writtenMass[k])
+                return true;
+        }
+        return false;
+    }
+
+    // Перед глобальным шагом: слот родителя = барицентр с полной массой
+    void beginSubsystems() {
+        for (auto& sub : m_subsystems) {
+            const int p = sub.parent;
+            const int k = (int)sub.members.size();
+            if (changedOutside(sub)) {
+                sub.localPos.resize(k);
+                sub.localVel.resize(k);
+                sub.localAcc.assign(k, Eigen::Vector3d::Zero());
+                for (int m = 0; m < k; ++m) {
+                    sub.localPos[m] = positions[sub.members[m]] - positions[p];
+                    sub.localVel[m] = velocities[sub.members[m]] - velocities[p];
+                }
+                sub.synced = true;
+            }
+
+            double total = masses[p];
+            Eigen::Vector3d shift = Eigen::Vector3d::Zero(), vshift = Eigen::Vector3d::Zero();
+            for (int m = 0; m < k; ++m) {
+                const double mm = masses[sub.members[m]];
+                total += mm;
+                shift += mm * sub.localPos[m];
+                vshift += mm * sub.localVel[m];
+                m_effMass[sub.members[m]] = 0.0;
+            }
+            m_effMass[p] = total;
+            if (total > 0.0) {
+                positions[p] += shift / total;
+                velocities[p] += vshift / total;
+            }
+            if (sub.hasBaryAcc) accelerations[p] = sub.baryAcc;
+        }
+
+        // Приливы — когда все родители уже стоят в барицентрах
+        for (auto& sub : m_subsystems) sub.tidalStart = tidalTensor(sub);
+    }
+
+    // После глобального шага: спутники догоняют dt подшагами, затем
+    // абсолютные координаты восстанавливаются из барицентра и локальных
+    void endSubsystems(double dt) {
+        const int count = (int)m_subsystems.size();
+        m_tracks.resize(recordSubsteps ? count : 0);
+        if (count == 0) return;
+
+        std::vector<Eigen::Matrix3d> tidalEnd(count);
+        #pragma omp parallel for schedule(dynamic) if(count >= 4)
+        for (int b = 0; b < count; ++b) tidalEnd[b] = tidalTensor(m_subsystems[b]);
+
+        #pragma omp parallel for schedule(dynamic) if(count >= 4)
+        for (int b = 0; b < count; ++b) {
+            Subsystem& sub = m_subsystems[b];
+            sub.baryAcc = accelerations[sub.parent];
+            sub.hasBaryAcc = true;
+            integrateLocal(sub, dt, tidalEnd[b], recordSubsteps ? &m_tracks[b] : nullptr);
+            writeAbsolute(sub);
+        }
+    }
+
+    // Приливный тензор внешних масс в барицентре подсистемы: a_tidal(r) = T r
+    Eigen::Matrix3d tidalTensor(const Subsystem& sub) const {
+        const Eigen::Vector3d& center = positions[sub.parent];
+        Eigen::Matrix3d T = Eigen::Matrix3d::Zero();
+        for (int j = 0; j < size(); ++j) {
+            if (j == sub.parent || m_effMass[j] == 0.0) continue;
+            const Eigen::Vector3d d = positions[j] - center;
+            const double r2 = d.squaredNorm();
+            if (r2 < kMinDist2) continue;
+            const double r = std::sqrt(r2);
+            const double gm = G * m_effMass[j];
+            T += gm / (r2 * r) * (3.0 * d * d.transpose() / r2 - Eigen::Matrix3d::Identity());
+        }
+        return T;
+    }
+
+    // Планетоцентрические ускорения: центральное тело, взаимные + косвенный член, прилив
+    void localAccelerations(const Subsystem& sub, const Eigen::Matrix3d& tidal, std::vector<Eigen::Vector3d>& out) const {
+        const int k = (int)sub.members.size();
+        const double gmParent = G * masses[sub.parent];
+        for (int m = 0; m < k; ++m) {
+            const Eigen::Vector3d& r = sub.localPos[m];
+            const double r2 = std::max(r.squaredNorm(), 1.0);
+            Eigen::Vector3d a = -(gmParent + G * masses[sub.members[m]]) / (r2 * std::sqrt(r2)) * r + tidal * r;
+            for (int l = 0; l < k; ++l) {
+                if (l == m) continue;
+                const Eigen::Vector3d& rl = sub.localPos[l];
+                const Eigen::Vector3d d = rl - r;
+                const double d2 = std::max(d.squaredNorm(), 1.0);
+                const double rl2 = std::max(rl.squaredNorm(), 1.0);
+                const double gm = G * masses[sub.members[l]];
+                a += gm * (d / (d2 * std::sqrt(d2)) - rl / (rl2 * std::sqrt(rl2)));
+            }
+            out[m] = a;
+        }
+    }
+
+    // Yoshida 4-го порядка (три leapfrog KDK): симплектичен, как Verlet, но фаза
+    // спутника за сотни оборотов не уплывает. Шаг — доля самого короткого периода.
+    void integrateLocal(Subsystem& sub, double dt, const Eigen::Matrix3d& tidalEnd, SubstepTrack* track) {
+        const int k = (int)sub.members.size();
+        const double gmParent = G * masses[sub.parent];
+
+        double minPeriod = std::abs(dt);
+        for (int m = 0; m < k; ++m) {
+            const double mu = gmParent + G * masses[sub.members[m]];
+            const double r = sub.localPos[m].norm();
+            if (mu > 0.0 && r > 0.0) minPeriod = std::min(minPeriod, kTwoPi * std::sqrt(r * r * r / mu));
+        }
+        const double target = minPeriod / std::max(1, subsystemStepsPerOrbit);
+        const int substeps = std::clamp((int)std::ceil(std::abs(dt) / target), 1, 1 << 20);
+        const double h = dt / substeps;
+
+        const double cbrt2 = std::cbrt(2.0);
+        const double w1 = 1.0 / (2.0 - cbrt2);
+        const double stages[3] = {w1, -cbrt2 * w1, w1};
+
+        // Прилив линейно между началом и концом глобального шага
+        auto tidalAt = [&](double t) { return sub.tidalStart + (tidalEnd - sub.tidalStart) * (t / dt); };
+
+        std::vector<Eigen::Vector3d>& acc = sub.localAcc;
+        auto record = [&]() {
+            if (!track) return;
+            track->pos.insert(track->pos.end(), sub.localPos.begin(), sub.localPos.end());
+            track->vel.insert(track->vel.end(), sub.localVel.begin(), sub.localVel.end());
+            track->acc.insert(track->acc.end(), acc.begin(), acc.end());
+        };
+        if (track) {
+            track->parent = sub.parent;
+            track->members = sub.members;
+            track->substeps = substeps;
+            track->pos.clear();
+            track->vel.clear();
+            track->acc.clear();
+        }
+
+        double t = 0.0;
+        localAccelerations(sub, tidalAt(t), acc);
+        record();
+        for (int s = 0; s < substeps; ++s) {
+            for (double w : stages) {
+                const double hs = w * h;
+                for (int m = 0; m < k; ++m) {
+                    sub.localVel[m] += 0.5 * hs * acc[m];
+                    sub.localPos[m] += hs * sub.localVel[m];
+                }
+                t += hs;
+                localAccelerations(sub, tidalAt(t), acc);
+                for (int m = 0; m < k; ++m) sub.localVel[m] += 0.5 * hs * acc[m];
+            }
+            record();
+        }
+    }
+
+    void writeAbsolute(Subsystem& sub) {
+        const int p = sub.parent;
+        const int k = (int)sub.members.size();
+
+        double total = masses[p];
+        Eigen::Vector3d shift = Eigen::Vector3d::Zero(), vshift = Eigen::Vector3d::Zero(), ashift = Eigen::Vector3d::Zero();
+        for (int m = 0; m < k; ++m) {
+            const double mm = masses[sub.members[m]];
+            total += mm;
+            shift += mm * sub.localPos[m];
+            vshift += mm * sub.localVel[m];
+            ashift += mm * sub.localAcc[m];
+        }
+        if (total > 0.0) { shift /= total; vshift /= total; ashift /= total; }
+
+        positions[p] -= shift;
+        velocities[p] -= vshift;
+        accelerations[p] = sub.baryAcc - ashift;
+        for (int m = 0; m < k; ++m) {
+            const int i = sub.members[m];
+            positions[i] = positions[p] + sub.localPos[m];
+            velocities[i] = velocities[p] + sub.localVel[m];
+            accelerations[i] = accelerations[p] + sub.localAcc[m];
+        }
+
+        sub.writtenPos.resize(k + 1);
+        sub.writtenVel.resize(k + 1);
+        sub.writtenMass.resize(k + 1);
+        for (int m = 0; m <= k; ++m) {
+            const int i = (m == 0) ? p : sub.members[m - 1];
+            sub.writtenPos[m] = positions[i];
+            sub.writtenVel[m] = velocities[i];
+            sub.writtenMass[m] = masses[i];
+        }
+    }
+
+    // Непрерывный диапазон индексов текущего потока. Одно и то же разбиение
+    // во всех циклах шага: поток пишет только "свои" тела, поэтому барьеры
+    // нужны лишь вокруг расчета сил, а данные остаются на его NUMA-узле.
+    static void ownedRange(int n, int& begin, int& end) {
+        const int threads = omp_get_num_threads();
+        const int tid = omp_get_thread_num();
+        const int chunk = n / threads;
+        const int rest = n % threads;
+        begin = tid * chunk + std::min(tid, rest);
+        end = begin + chunk + (tid < rest ? 1 : 0);
+    }
+
+    // --- Velocity Verlet (Стабильный) ---
+    void stepVerlet(double dt) {
+        const int n = size();
+        int begin, end;
+        ownedRange(n, begin, end);
+
+        // 1. Сохраняем a(t) и двигаем: r(t+dt) = r(t) + v(t)dt + 0.5 * a(t) * dt^2
+        for (int i = begin; i < end; ++i) {
+            m_oldAccBuffer[i] = accelerations[i];
+            positions[i] += velocities[i] * dt + 0.5 * accelerations[i] * dt * dt;
+        }
+
+        // 2. Считаем a(t+dt).
+        // ВНИМАНИЕ: Это пишет в m_accBuffer, но не трогает m_oldAccBuffer!
+        computeAccelerationsForState();
+
+        // 3. v(t+dt) = v(t) + 0.5 * (a(t) + a(t+dt)) * dt
+        for (int i = begin; i < end; ++i) {
+            velocities[i] += 0.5 * (m_oldAccBuffer[i] + accelerations[i]) * dt;
+        }
+    }
+
+    // --- Runge-Kutta 4 (Точный) ---
+    // k_x стадии — это скорость промежуточного состояния, k_v — ускорение.
+    // Взвешенные суммы копятся сразу, без временных векторов на каждом шаге.
+    void stepRK4(double dt) {
+        const int n = size();
+        int begin, end;
+        ownedRange(n, begin, end);
+
+        const double weight[4] = {1.0, 2.0, 2.0, 1.0};
+        const double shift[3] = {dt / 2.0, dt / 2.0, dt};
+
+        // Начальное состояние
+        for (int i = begin; i < end; ++i) {
+            m_stateBuffer[i] = State(positions[i], velocities[i]);
+            m_sumX[i].setZero();
+            m_sumV[i].setZero();
+        }
+
+        // K1..K4
+        for (int s = 0; s < 4; ++s) {
+            computeAccFromState(m_stateBuffer, m_kAccBuffer);
+
+            for (int i = begin; i < end; ++i) {
+                const Eigen::Vector3d kx = m_stateBuffer[i].vel;
+                const Eigen::Vector3d kv = m_kAccBuffer[i];
+                m_sumX[i] += weight[s] * kx;
+                m_sumV[i] += weight[s] * kv;
+                if (s < 3) {
+                    m_stateBuffer[i].pos = positions[i] + kx * shift[s];
+                    m_stateBuffer[i].vel = velocities[i] + kv * shift[s];
+                }
+            }
+        }
+
+        // Финал
+        for (int i = begin; i < end; ++i) {
+            positions[i] += (dt / 6.0) * m_sumX[i];
+            velocities[i] += (dt / 6.0) * m_sumV[i];
+        }
+
+        // Обновляем ускорение для следующего шага
+        computeAccelerationsForState();
+    }
+
+    // Расчет сил: вызывается всеми потоками региона (или одним вне его)
+    void computeAccFromState(const std::vector<State>& states, std::vector<Eigen::Vector3d>& results) {
+        const int n = (int)states.size();
+        int begin, end;
+        ownedRange(n, begin, end);
+
+        // SoA — только тела общего ядра, k -> body(k). Список по возрастанию,
+        // поэтому свои тела потока — непрерывный отрезок [kBegin, kEnd)
+        const int* body = m_global.empty() ? nullptr : m_global.data();
+        const int count = body ? (int)m_global.size() : n;
+        int kBegin = begin, kEnd = end;
+        if (body) {
+            kBegin = (int)(std::lower_bound(body, body + count, begin) - body);
+            kEnd = (int)(std::lower_bound(body, body + count, end) - body);
+            // Спутники летят по инерции до writeAbsolute в endSubsystems
+            for (int i = begin; i < end; ++i) if (m_isMoon[i]) results[i].setZero();
+        }
+
+        // 1. Упаковываем свои тела в SoA
+        for (int k = kBegin; k < kEnd; ++k) {
+            const int i = body ? body[k] : k;
+            m_px[k] = states[i].pos.x();
+            m_py[k] = states[i].pos.y();
+            m_pz[k] = states[i].pos.z();
+            m_gm[k] = G * m_massSource[i];
+        }
+        #pragma omp barrier
+
+        // 2. Свои i-блоки против всех j-блоков
+        for (int k0 = kBegin; k0 < kEnd; k0 += kTileI) {
+            accumulateTile(k0, std::min(kEnd, k0 + kTileI), count, body, states, results);
+        }
+
+        // Никто не перепишет SoA, пока остальные его читают
+        #pragma omp barrier
+    }
+
+    void accumulateTile(int i0, int i1, int n, const int* body, const std::vector<State>& states, std::vector<Eigen::Vector3d>& results) {
+        const double* px = m_px.data();
+        const double* py = m_py.data();
+        const double* pz = m_pz.data();
+        const double* gm = m_gm.data();
+
+        double ax[kTileI] = {}, ay[kTileI] = {}, az[kTileI] = {};
+
+        for (int j0 = 0; j0 < n; j0 += kTileJ) {
+            const int j1 = std::min(n, j0 + kTileJ);
+
+            for (int i = i0; i < i1; ++i) {
+                const double xi = px[i], yi = py[i], zi = pz[i];
+                double sx = 0.0, sy = 0.0, sz = 0.0;
+
+                #pragma omp simd reduction(+:sx,sy,sz)
+                for (int j = j0; j < j1; ++j) {
+                    const double dx = px[j] - xi;
+                    const double dy = py[j] - yi;
+                    const double dz = pz[j] - zi;
+                    const double dist2 = dx * dx + dy * dy + dz * dz;
+
+                    // Мягкое ядро отсекает и слишком близкие пары, и само тело (i == j)
+                    const double s = (dist2 < kMinDist2) ? 0.0 : gm[j] / (dist2 * std::sqrt(dist2));
+                    sx += dx * s;
+                    sy += dy * s;
+                    sz += dz * s;
+                }
+                ax[i - i0] += sx;
+                ay[i - i0] += sy;
+                az[i - i0] += sz;
+            }
+        }
+
+        for (int k = i0; k < i1; ++k) {
+            const int i = body ? body[k] : k;
+            Eigen::Vector3d acc(ax[k - i0], ay[k - i0], az[k - i0]);
+            if (useRelativity) {
+                // Поправка зависит только от тела i — выносим из суммы
+                double v_sq = states[i].vel.squaredNorm();
+                acc *= 1.0 + (3.0 * v_sq) / (C * C);
+            }
+            results[i] = acc;
+        }
+    }
+
+    void computeAccelerationsForState() {
+        const int n = size();
+        int begin, end;
+        ownedRange(n, begin, end);
+
+        for (int i = begin; i < end; ++i) {
+            m_stateBuffer[i] = State(positions[i], velocities[i]);
+        }
+
+        // Используем m_accBuffer как временное хранилище
+        computeAccFromState(m_stateBuffer, m_accBuffer);
+
+        for (int i = begin; i < end; ++i) {
+            accelerations[i] = m_accBuffer[i];
+        }
+    }
+};
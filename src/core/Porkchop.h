@@ -0,0 +1,387 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <algorithm>
+#include <omp.h>
+#include <Eigen/Dense>
+#include "NBodyEngine.h"
+
+// Окна запуска ("porkchop"): задача Ламберта в каждой клетке сетки
+// дата отправления x дата прибытия. Положения тел берутся не из таблиц,
+// а из распространения копии текущего состояния движка.
+
+// --- Задача Ламберта (универсальные переменные, 0 витков) ---
+namespace lambert {
+
+// Функции Штумпфа C(z), S(z) без ветвлений и тригонометрии (векторизуются):
+// ряд при z / 4^8, затем 8 удвоений аргумента
+//   C(4z) = (1 - z S)^2 / 2,   S(4z) = (S + C - z S C) / 4,
+// годных и для эллипса (z > 0), и для гиперболы (z < 0).
+constexpr int kStumpffHalvings = 8;
+
+inline void stumpff(double z, double& c, double& s) {
+    double w = z * (1.0 / 65536.0); // 4^-8
+    double cw = 0.5 - w * (1.0 / 24.0 - w * (1.0 / 720.0 - w * (1.0 / 40320.0 - w * (1.0 / 3628800.0 - w / 479001600.0))));
+    double sw = 1.0 / 6.0 - w * (1.0 / 120.0 - w * (1.0 / 5040.0 - w * (1.0 / 362880.0 - w * (1.0 / 39916800.0 - w / 6227020800.0))));
+    for (int k = 0; k < kStumpffHalvings; ++k) {
+        const double t = 1.0 - w * sw;
+        const double sNext = 0.25 * (sw + cw - w * sw * cw);
+        cw = 0.5 * t * t;
+        sw = sNext;
+        w *= 4.0;
+    }
+    c = cw;
+    s = sw;
+}
+
+// Граница 0-виткового решения: при z -> 4pi^2 время перелета уходит в бесконечность
+constexpr double kZMax = 4.0 * 3.14159265358979323846 * 3.14159265358979323846;
+constexpr double kZMin = -1.0e4; // Гипербола с разностью аномалий ~100 — дальше не бывает
+constexpr int kMaxIterations = 64;
+
+// Рабочие массивы пачки (по одному набору на поток)
+struct LambertScratch {
+    std::vector<double> buf;
+    std::vector<int> lane;
+};
+
+// Пачка задач в виде SoA: sumR = |r1| + |r2|, A = +-sqrt(|r1||r2| + r1.r2),
+// tof — время перелета. Итерация — один проход omp simd по несошедшимся
+// задачам: Ньютон по z с отступлением к бисекции внутри вилки [lo, hi],
+// без ветвлений, так что у всех дорожек один поток команд. После прохода
+// сошедшиеся задачи выбывают, остальные сдвигаются в начало массивов.
+// На выходе y(z) решения; NaN — решения нет (tof <= 0, перелет на 180 градусов).
+inline void solveBatch(int n, const double* sumR, const double* A, const double* tof, double mu, double* y,
+                       LambertScratch& scratch) {
+    scratch.buf.resize(7 * (size_t)n);
+    scratch.lane.resize(n);
+    double* sR = scratch.buf.data();
+    double* a = sR + n;
+    double* t = a + n;
+    double* z = t + n;
+    double* lo = z + n;
+    double* hi = lo + n;
+    double* yz = hi + n;
+    int* lane = scratch.lane.data();
+    const double sqrtMu = std::sqrt(mu);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    int m = 0;
+    for (int k = 0; k < n; ++k) {
+        y[k] = nan;
+        if (!(tof[k] > 0.0) || std::abs(A[k]) < 1e-12 * sumR[k]) continue;
+        sR[m] = sumR[k]; a[m] = A[k]; t[m] = sqrtMu * tof[k];
+        z[m] = 0.0; lo[m] = kZMin; hi[m] = kZMax;
+        lane[m++] = k;
+    }
+
+    for (int it = 0; it < kMaxIterations && m > 0; ++it) {
+        #pragma omp simd
+        for (int k = 0; k < m; ++k) {
+            const double zk = z[k], ak = a[k];
+            double c, s;
+            stumpff(zk, c, s);
+            const double yk = sR[k] + ak * (zk * s - 1.0) / std::sqrt(c);
+            const bool tooShort = yk < 0.0; // Слишком малое z (только при A > 0)
+            const double yp = tooShort ? 1.0 : yk;
+
+            const double yc = yp / c;
+            const double chi3 = yc * std::sqrt(yc);
+            const double F = chi3 * s + ak * std::sqrt(yp) - t[k];
+            const bool below = tooShort | (F < 0.0);
+            const double lok = below ? zk : lo[k];
+            const double hik = below ? hi[k] : zk;
+
+            const bool nearZero = std::abs(zk) <= 1e-3;
+            const double zSafe = nearZero ? 1.0 : zk;
+            const double dFz = chi3 * ((c - 1.5 * s / c) / (2.0 * zSafe) + 0.75 * s * s / c)
+                             + 0.125 * ak * (3.0 * s / c * std::sqrt(yp) + ak * std::sqrt(c / yp));
+            const double dF0 = std::sqrt(2.0) / 40.0 * yp * std::sqrt(yp)
+                             + 0.125 * ak * (std::sqrt(yp) + ak * std::sqrt(0.5 / yp));
+            const double newton = zk - F / (nearZero ? dF0 : dFz);
+            const bool live = !tooShort;
+            const bool inside = live & (newton > lok) & (newton < hik);
+            const bool converged = live &
+                ((std::abs(F) <= 1e-11 * t[k]) | (hik - lok <= 1e-14 * (1.0 + std::abs(zk))));
+
+            z[k] = inside ? newton : 0.5 * (lok + hik);
+            lo[k] = lok;
+            hi[k] = hik;
+            yz[k] = converged ? yk : -1.0; // -1 — еще не сошлась
+        }
+
+        // Сошедшиеся — в ответ, остальные — в начало массивов
+        int w = 0;
+        for (int k = 0; k < m; ++k) {
+            if (yz[k] >= 0.0) { y[lane[k]] = yz[k]; continue; }
+            sR[w] = sR[k]; a[w] = a[k]; t[w] = t[k];
+            z[w] = z[k]; lo[w] = lo[k]; hi[w] = hi[k];
+            lane[w++] = lane[k];
+        }
+        m = w;
+    }
+}
+
+// Одна задача: скорости на концах дуги r1 -> r2 за tof. Короткий путь — движение
+// в ту же сторону, что и нормаль plane (обычно момент импульса тела отправления).
+inline bool solve(const Eigen::Vector3d& r1, const Eigen::Vector3d& r2, double tof, double mu,
+                  const Eigen::Vector3d& plane, Eigen::Vector3d& v1, Eigen::Vector3d& v2) {
+    const double n1 = r1.norm(), n2 = r2.norm();
+    const double sumR = n1 + n2;
+    const double sign = (r1.cross(r2).dot(plane) >= 0.0) ? 1.0 : -1.0;
+    const double A = sign * std::sqrt(std::max(0.0, n1 * n2 + r1.dot(r2)));
+    double y;
+    LambertScratch scratch;
+    solveBatch(1, &sumR, &A, &tof, mu, &y, scratch);
+    if (!(y >= 0.0)) return false;
+
+    const double f = 1.0 - y / n1;
+    const double g = A * std::sqrt(y / mu);
+    const double gdot = 1.0 - y / n2;
+    v1 = (r2 - f * r1) / g;
+    v2 = (gdot * r2 - r1) / g;
+    return true;
+}
+
+} // namespace lambert
+
+// --- Запрос и результат ---
+struct PorkchopRequest {
+    int departureBody = -1;
+    int arrivalBody = -1;
+    int centralBody = -1; // -1 — самое массивное тело
+
+    // Даты — модельное время движка, с (не раньше текущего)
+    double departureStart = 0.0, departureEnd = 0.0;
+    int departureCount = 100;
+    double arrivalStart = 0.0, arrivalEnd = 0.0;
+    int arrivalCount = 100;
+
+    double ephemerisStep = 86400.0; // Наибольший шаг распространения эфемерид, с
+    double minPerturberMass = 1e20; // Более легкие тела (популяции) в эфемериды не берутся
+};
+
+// Сетка [departure][arrival]; NaN — перелета нет (прибытие раньше отправления и т.п.)
+struct PorkchopGrid {
+    int departureCount = 0, arrivalCount = 0;
+    std::vector<double> departureTimes, arrivalTimes;
+    std::vector<float> c3;          // Характеристическая энергия отлета, м^2/с^2
+    std::vector<float> vInfArrival; // Гиперболический избыток на прибытии, м/с
+    std::vector<float> deltaV;      // sqrt(C3) + vInfArrival, м/с
+    double seconds = 0.0;           // Время расчета (эфемериды + сетка)
+
+    size_t index(int i, int j) const { return (size_t)i * arrivalCount + j; }
+
+    // Клетка с наименьшим deltaV; false, если решений нет
+    bool best(int& bi, int& bj) const {
+        float m = std::numeric_limits<float>::infinity();
+        bi = bj = -1;
+        for (int i = 0; i < departureCount; ++i)
+            for (int j = 0; j < arrivalCount; ++j) {
+                float v = deltaV[index(i, j)];
+                if (v < m) { m = v; bi = i; bj = j; }
+            }
+        return bi >= 0;
+    }
+};
+
+// Причина отказа для вызывающего (необязательный выход)
+inline bool porkchopFail(std::string* error, const char* reason) {
+    if (error) *error = reason;
+    return false;
+}
+
+// --- Эфемериды ---
+// Положения и скорости тел (относительно центрального) на заданные даты.
+// Распространяется копия движка только из массивных тел, каждая дата
+// считается ровно один раз и попадает в кеш, откуда ее читают все клетки.
+class EphemerisCache {
+public:
+    bool build(const NBodyEngine& engine, const std::vector<int>& bodies, int central,
+               std::vector<double> times, double maxStep, double minPerturberMass, std::string* error = nullptr) {
+        m_times.clear();
+        m_states.clear();
+        const int n = engine.size();
+        if (central < 0 || central >= n) return porkchopFail(error, "Central body is out of range.");
+        if (times.empty()) return porkchopFail(error, "The date grid is empty.");
+        if (!(maxStep > 0.0)) return porkchopFail(error, "Ephemeris step must be positive.");
+        for (int b : bodies) if (b < 0 || b >= n) return porkchopFail(error, "Body is out of range.");
+        std::sort(times.begin(), times.end());
+        times.erase(std::unique(times.begin(), times.end()), times.end());
+        if (times.front() < engine.time) return porkchopFail(error, "Dates before the current simulation time.");
+
+        // Копия: нужные тела + все, кто заметно возмущает
+        std::vector<int> map(n, -1);
+        NBodyEngine copy;
+        copy.currentIntegrator = engine.currentIntegrator;
+        copy.useRelativity = engine.useRelativity;
+        copy.subsystemStepsPerOrbit = engine.subsystemStepsPerOrbit;
+        copy.time = engine.time;
+        for (int i = 0; i < n; ++i) {
+            bool needed = (i == central) || engine.masses[i] >= minPerturberMass
+                       || std::find(bodies.begin(), bodies.end(), i) != bodies.end();
+            if (!needed) continue;
+            map[i] = copy.size();
+            copy.addBody(engine.masses[i], engine.positions[i], engine.velocities[i]);
+        }
+        for (int i = 0; i < n; ++i) {
+            int p = engine.parentOf(i);
+            if (map[i] >= 0 && p >= 0 && map[p] >= 0) copy.setParent(map[i], map[p]);
+        }
+
+        m_bodies = bodies;
+        m_times = times;
+        m_states.resize(times.size() * bodies.size());
+        const int c = map[central];
+        for (size_t t = 0; t < times.size(); ++t) {
+            while (copy.time < times[t]) {
+                double h = std::min(maxStep, times[t] - copy.time);
+                if (h < 1e-6 * maxStep) { copy.time = times[t]; break; }
+                copy.step(h);
+            }
+            for (size_t b = 0; b < bodies.size(); ++b) {
+                const int k = map[bodies[b]];
+                State& s = m_states[t * bodies.size() + b];
+                s.position = copy.positions[k] - copy.positions[c];
+                s.velocity = copy.velocities[k] - copy.velocities[c];
+            }
+        }
+        return true;
+    }
+
+    // Состояние тела (номер в списке bodies из build) на дату из списка times
+    void at(double time, int bodySlot, Eigen::Vector3d& pos, Eigen::Vector3d& vel) const {
+        size_t t = std::lower_bound(m_times.begin(), m_times.end(), time) - m_times.begin();
+        const State& s = m_states[t * m_bodies.size() + bodySlot];
+        pos = s.position;
+        vel = s.velocity;
+    }
+
+private:
+    struct State { Eigen::Vector3d position, velocity; };
+    std::vector<int> m_bodies;
+    std::vector<double> m_times;
+    std::vector<State> m_states;
+};
+
+// --- Сетка ---
+inline std::vector<double> porkchopDates(double start, double end, int count) {
+    std::vector<double> t(std::max(count, 0));
+    for (int i = 0; i < count; ++i) t[i] = (count > 1) ? start + (end - start) * i / (count - 1) : start;
+    return t;
+}
+
+// Строки сетки (даты отправления) — по потокам; внутри строки все даты прибытия
+// решаются одной пачкой solveBatch.
+inline bool computePorkchop(const NBodyEngine& engine, const PorkchopRequest& req, PorkchopGrid& out,
+                            std::string* error = nullptr) {
+    const double t0 = omp_get_wtime();
+    const int n = engine.size();
+    if (req.departureBody < 0 || req.departureBody >= n || req.arrivalBody < 0 || req.arrivalBody >= n)
+        return porkchopFail(error, "Departure or arrival body is out of range.");
+    if (req.departureBody == req.arrivalBody) return porkchopFail(error, "Choose two different bodies.");
+    if (req.departureCount < 1 || req.arrivalCount < 1) return porkchopFail(error, "The date grid is empty.");
+
+    int central = req.centralBody;
+    if (central < 0) {
+        central = 0;
+        for (int i = 1; i < n; ++i) if (engine.masses[i] > engine.masses[central]) central = i;
+    }
+    if (central >= n) return porkchopFail(error, "Central body is out of range.");
+    if (central == req.departureBody || central == req.arrivalBody)
+        return porkchopFail(error, "Departure and arrival must differ from the central body.");
+
+    out.departureCount = req.departureCount;
+    out.arrivalCount = req.arrivalCount;
+    out.departureTimes = porkchopDates(req.departureStart, req.departureEnd, req.departureCount);
+    out.arrivalTimes = porkchopDates(req.arrivalStart, req.arrivalEnd, req.arrivalCount);
+
+    std::vector<double> dates = out.departureTimes;
+    dates.insert(dates.end(), out.arrivalTimes.begin(), out.arrivalTimes.end());
+    EphemerisCache ephemeris;
+    if (!ephemeris.build(engine, {req.departureBody, req.arrivalBody}, central, dates,
+                         req.ephemerisStep, req.minPerturberMass, error)) return false;
+
+    // Даты прибытия общие для всех строк — их состояния читаем один раз
+    const int na = req.arrivalCount;
+    std::vector<Eigen::Vector3d> arrPos(na), arrVel(na);
+    for (int j = 0; j < na; ++j) ephemeris.at(out.arrivalTimes[j], 1, arrPos[j], arrVel[j]);
+
+    const double mu = NBodyEngine::G * engine.masses[central];
+    const size_t cells = (size_t)req.departureCount * na;
+    out.c3.assign(cells, 0.0f);
+    out.vInfArrival.assign(cells, 0.0f);
+    out.deltaV.assign(cells, 0.0f);
+    const float nanf = std::numeric_limits<float>::quiet_NaN();
+
+    #pragma omp parallel
+    {
+        std::vector<double> sumR(na), A(na), tof(na), y(na), n2(na);
+        lambert::LambertScratch scratch;
+
+        #pragma omp for schedule(dynamic, 4)
+        for (int i = 0; i < req.departureCount; ++i) {
+            Eigen::Vector3d r1, depVel;
+            ephemeris.at(out.departureTimes[i], 0, r1, depVel);
+            const double n1 = r1.norm();
+            const Eigen::Vector3d plane = r1.cross(depVel);
+
+            for (int j = 0; j < na; ++j) {
+                const Eigen::Vector3d& r2 = arrPos[j];
+                n2[j] = r2.norm();
+                sumR[j] = n1 + n2[j];
+                const double sign = (r1.cross(r2).dot(plane) >= 0.0) ? 1.0 : -1.0;
+                A[j] = sign * std::sqrt(std::max(0.0, n1 * n2[j] + r1.dot(r2)));
+                tof[j] = out.arrivalTimes[j] - out.departureTimes[i];
+            }
+
+            lambert::solveBatch(na, sumR.data(), A.data(), tof.data(), mu, y.data(), scratch);
+
+            for (int j = 0; j < na; ++j) {
+                const size_t cell = out.index(i, j);
+                if (!(y[j] >= 0.0)) {
+                    out.c3[cell] = out.vInfArrival[cell] = out.deltaV[cell] = nanf;
+                    continue;
+                }
+                const Eigen::Vector3d& r2 = arrPos[j];
+                const double f = 1.0 - y[j] / n1;
+                const double g = A[j] * std::sqrt(y[j] / mu);
+                const double gdot = 1.0 - y[j] / n2[j];
+                const Eigen::Vector3d v1 = (r2 - f * r1) / g;
+                const Eigen::Vector3d v2 = (gdot * r2 - r1) / g;
+
+                const double vDep = (v1 - depVel).norm();
+                const double vArr = (v2 - arrVel[j]).norm();
+                out.c3[cell] = (float)(vDep * vDep);
+                out.vInfArrival[cell] = (float)vArr;
+                out.deltaV[cell] = (float)(vDep + vArr);
+            }
+        }
+    }
+
+    out.seconds = omp_get_wtime() - t0;
+    return true;
+}
+
+// CSV для внешних инструментов: одна строка на клетку, даты в сутках модельного времени
+inline bool writePorkchopCsv(const std::string& path, const PorkchopGrid& grid) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "departure_day,arrival_day,flight_days,c3_km2_s2,vinf_arrival_km_s,delta_v_km_s\n");
+    for (int i = 0; i < grid.departureCount; ++i) {
+        for (int j = 0; j < grid.arrivalCount; ++j) {
+            const size_t cell = grid.index(i, j);
+            const double dep = grid.departureTimes[i] / 86400.0, arr = grid.arrivalTimes[j] / 86400.0;
+            if (std::isnan(grid.deltaV[cell])) {
+                std::fprintf(f, "%.4f,%.4f,%.4f,,,\n", dep, arr, arr - dep);
+            } else {
+                std::fprintf(f, "%.4f,%.4f,%.4f,%.6g,%.6g,%.6g\n", dep, arr, arr - dep,
+                             grid.c3[cell] * 1e-6, grid.vInfArrival[cell] * 1e-3, grid.deltaV[cell] * 1e-3);
+            }
+        }
+    }
+    return std::fclose(f) == 0;
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+#include <cstdio>
+#include <algorithm>
+#include <omp.h>
+#include <Eigen/Dense>
+
+// Чтение и запись файлов сценариев (*.json, как пишет MainWindow::saveSimulation)
+// без Qt — для утилит командной строки. Понимает ровно этот формат:
+// { "bodies": [ { "name": ..., "mass": ..., "posX": ..., ... }, ... ] }
+struct ScenarioBody {
+    std::string name;
+    std::string color = "#ffffff";
+    std::string parent; // Имя тела-хозяина подсистемы (спутник), пусто — в общем интеграторе
+    double mass = 0.0;
+    double radius = 0.0;
+    Eigen::Vector3d position = Eigen::Vector3d::Zero();
+    Eigen::Vector3d velocity = Eigen::Vector3d::Zero();
+};
+
+namespace scenario_detail {
+
+class Parser {
+public:
+    explicit Parser(const std::string& text) : m_s(text) {}
+
+    bool parseRoot(std::vector<ScenarioBody>& bodies) {
+        if (!expect('{')) return false;
+        if (peek() == '}') { ++m_p; return true; }
+        while (true) {
+            std::string key;
+            if (!parseString(key) || !expect(':')) return false;
+            if (key == "bodies") {
+                if (!parseBodies(bodies)) return false;
+            } else if (!skipValue()) {
+                return false;
+            }
+            if (peek() == ',') { ++m_p; continue; }
+            return expect('}');
+        }
+    }
+
+private:
+    const std::string& m_s;
+    size_t m_p = 0;
+
+    char peek() {
+        while (m_p < m_s.size() && std::isspace((unsigned char)m_s[m_p])) ++m_p;
+        return m_p < m_s.size() ? m_s[m_p] : '\0';
+    }
+
+    bool expect(char c) {
+        if (peek() != c) return false;
+        ++m_p;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (!expect('"')) return false;
+        out.clear();
+        while (m_p < m_s.size() && m_s[m_p] != '"') {
+            if (m_s[m_p] != '\\') { out += m_s[m_p++]; continue; }
+            if (++m_p >= m_s.size()) return false;
+            const char c = m_s[m_p++];
+            switch (c) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': if (!parseCodePoint(out)) return false; break;
+            default: out += c; // \" \\ \/
+            }
+        }
+        return expect('"');
+    }
+
+    // \uXXXX -> UTF-8 (суррогатные пары не собираются: имена тел их не содержат)
+    bool parseCodePoint(std::string& out) {
+        if (m_p + 4 > m_s.size()) return false;
+        unsigned cp = 0;
+        for (int k = 0; k < 4; ++k) {
+            const char h = m_s[m_p++];
+            if (!std::isxdigit((unsigned char)h)) return false;
+            cp = cp * 16 + (unsigned)(std::isdigit((unsigned char)h) ? h - '0' : (std::tolower((unsigned char)h) - 'a' + 10));
+        }
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+        return true;
+    }
+
+    bool parseNumber(double& out) {
+        peek();
+        const char* begin = m_s.c_str() + m_p;
+        char* end = nullptr;
+        out = std::strtod(begin, &end);
+        if (end == begin) return false;
+        m_p += end - begin;
+        return true;
+    }
+
+    bool skipValue() {
+        char c = peek();
+        if (c == '"') { std::string tmp; return parseString(tmp); }
+        if (c == '{' || c == '[') {
+            const char close = (c == '{') ? '}' : ']';
+            ++m_p;
+            if (peek() == close) { ++m_p; return true; }
+            while (true) {
+                if (c == '{') {
+                    std::string key;
+                    if (!parseString(key) || !expect(':')) return false;
+                }
+                if (!skipValue()) return false;
+                if (peek() == ',') { ++m_p; continue; }
+                return expect(close);
+            }
+        }
+        for (const char* word : {"true", "false", "null"}) {
+            size_t len = std::char_traits<char>::length(word);
+            if (m_s.compare(m_p, len, word) == 0) { m_p += len; return true; }
+        }
+        double tmp;
+        return parseNumber(tmp);
+    }
+
+    bool parseBodies(std::vector<ScenarioBody>& bodies) {
+        if (!expect('[')) return false;
+        if (peek() == ']') { ++m_p; return true; }
+        while (true) {
+            ScenarioBody body;
+            if (!parseBody(body)) return false;
+            bodies.push_back(body);
+            if (peek() == ',') { ++m_p; continue; }
+            return expect(']');
+        }
+    }
+
+    bool parseBody(ScenarioBody& b) {
+        if (!expect('{')) return false;
+        if (peek() == '}') { ++m_p; return true; }
+        while (true) {
+            std::string key;
+            if (!parseString(key) || !expect(':')) return false;
+
+            double* target = nullptr;
+            if (key == "mass") target = &b.mass;
+            else if (key == "radius") target = &b.radius;
+            else if (key == "posX") target = &b.position.x();
+            else if (key == "posY") target = &b.position.y();
+            else if (key == "posZ") target = &b.position.z();
+            else if (key == "velX") target = &b.velocity.x();
+            else if (key == "velY") target = &b.velocity.y();
+            else if (key == "velZ") target = &b.velocity.z();
+
+            bool ok;
+            if (target) ok = parseNumber(*target);
+            else if (key == "name") ok = parseString(b.name);
+            else if (key == "color") ok = parseString(b.color);
+            else if (key == "parent") ok = parseString(b.parent);
+            else ok = skipValue();
+            if (!ok) return false;
+
+            if (peek() == ',') { ++m_p; continue; }
+            return expect('}');
+        }
+    }
+};
+
+// Строка JSON: кавычки, обратная косая и управляющие символы экранируются
+inline void appendQuoted(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char hex[8];
+                std::snprintf(hex, sizeof(hex), "\\u%04x", (unsigned)c);
+                out += hex;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+// Число без потери точности: %.17g занимает не больше 24 символов
+inline void appendNumber(std::string& out, double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.17g", value);
+    out += text;
+}
+
+} // namespace scenario_detail
+
+inline bool readScenario(const std::string& path, std::vector<ScenarioBody>& bodies) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    bodies.clear();
+    scenario_detail::Parser parser(text);
+    return parser.parseRoot(bodies);
+}
+
+// Запись в тот же формат. Тела форматируются параллельно блоками и пишутся
+// по порядку — файл на миллионы тел получается за секунды и не зависит от числа потоков.
+inline bool writeScenario(const std::string& path, const std::vector<ScenarioBody>& bodies) {
+    using scenario_detail::appendNumber;
+    using scenario_detail::appendQuoted;
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    const int n = (int)bodies.size();
+    const int block = 16384;
+    const int blocks = (n + block - 1) / block;
+    std::vector<std::string> text(blocks);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < blocks; ++b) {
+        std::string& out = text[b];
+        for (int i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+            const ScenarioBody& body = bodies[i];
+            out += "        {";
+            if (!body.parent.empty()) {
+                out += "\"parent\": ";
+                appendQuoted(out, body.parent);
+                out += ",\n         ";
+            }
+            out += "\"name\": ";
+            appendQuoted(out, body.name);
+            out += ", \"mass\": ";
+            appendNumber(out, body.mass);
+            out += ", \"radius\": ";
+            appendNumber(out, body.radius);
+            out += ", \"color\": ";
+            appendQuoted(out, body.color);
+            out += ",\n         \"posX\": ";
+            appendNumber(out, body.position.x());
+            out += ", \"posY\": ";
+            appendNumber(out, body.position.y());
+            out += ", \"posZ\": ";
+            appendNumber(out, body.position.z());
+            out += ",\n         \"velX\": ";
+            appendNumber(out, body.velocity.x());
+            out += ", \"velY\": ";
+            appendNumber(out, body.velocity.y());
+            out += ", \"velZ\": ";
+            appendNumber(out, body.velocity.z());
+            out += (i + 1 < n) ? "},\n" : "}\n";
+        }
+    }
+
+    file << "{\n    \"bodies\": [\n";
+    for (const auto& t : text) file << t;
+    file << "    ]\n}\n";
+    return (bool)file;
+}
+
+// Имена "parent" -> индексы тел (-1 — без родителя или имя не найдено)
+inline std::vector<int> scenarioParents(const std::vector<ScenarioBody>& bodies) {
+    std::vector<int> parents(bodies.size(), -1);
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        if (bodies[i].parent.empty()) continue;
+        for (size_t j = 0; j < bodies.size(); ++j) {
+            if (j != i && bodies[j].name == bodies[i].parent) { parents[i] = (int)j; break; }
+        }
+    }
+    return parents;
+}
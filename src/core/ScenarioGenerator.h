@@ -0,0 +1,334 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <omp.h>
+#include <Eigen/Dense>
+#include "NBodyEngine.h"
+
+// Процедурные популяции для масштабных сценариев: пояс астероидов,
+// пояс Койпера, протопланетный диск, скопление Пламмера.
+//
+// Детерминизм: у каждого тела свой генератор, зерно = hash(seed, индекс),
+// поэтому результат не зависит от числа потоков и порядка их работы.
+
+enum class PopulationKind {
+    AsteroidBelt,
+    KuiperBelt,
+    ProtoplanetaryDisk,
+    PlummerCluster
+};
+
+struct PopulationParams {
+    PopulationKind kind = PopulationKind::AsteroidBelt;
+    int count = 1000;
+    uint64_t seed = 1;
+
+    // Центральное тело (для поясов и диска) — задает mu кеплеровских орбит
+    double centralMass = 1.989e30;
+    Eigen::Vector3d centerPosition = Eigen::Vector3d::Zero();
+    Eigen::Vector3d centerVelocity = Eigen::Vector3d::Zero();
+
+    // Радиальный профиль: поверхностная плотность ~ r^(-densityIndex)
+    double innerRadius = 2.1 * 1.496e11;
+    double outerRadius = 3.3 * 1.496e11;
+    double densityIndex = 1.0;
+
+    // Распределения Рэлея для e и i (i в радианах)
+    double eccentricitySigma = 0.1;
+    double inclinationSigma = 0.1;
+
+    // Массы: dN/dm ~ m^(-massIndex) на [minMass, maxMass]; плотность — для радиусов
+    double minMass = 1e15;
+    double maxMass = 1e19;
+    double massIndex = 1.8;
+    double bodyDensity = 2000.0;
+
+    // Доля резонансных тел (плутино, 3:2 с Нептуном) — только для пояса Койпера
+    double resonantFraction = 0.2;
+    double resonantRadius = 39.4 * 1.496e11;
+
+    // Диск: полная масса и толщина h/r
+    double diskMass = 0.01 * 1.989e30;
+    double aspectRatio = 0.05;
+
+    // Скопление Пламмера: полная масса и масштабный радиус
+    double clusterMass = 1000.0 * 1.989e30;
+    double scaleRadius = 10.0 * 1.496e11;
+
+    // Готовые наборы параметров
+    static PopulationParams asteroidBelt(int count, uint64_t seed) {
+        PopulationParams p;
+        p.kind = PopulationKind::AsteroidBelt;
+        p.count = count; p.seed = seed;
+        return p;
+    }
+
+    static PopulationParams kuiperBelt(int count, uint64_t seed) {
+        PopulationParams p;
+        p.kind = PopulationKind::KuiperBelt;
+        p.count = count; p.seed = seed;
+        p.innerRadius = 42.0 * 1.496e11;
+        p.outerRadius = 48.0 * 1.496e11;
+        p.densityIndex = 0.0;
+        p.eccentricitySigma = 0.05;
+        p.inclinationSigma = 0.06;
+        p.minMass = 1e17;
+        p.maxMass = 1e21;
+        p.bodyDensity = 1000.0;
+        return p;
+    }
+
+    static PopulationParams protoplanetaryDisk(int count, uint64_t seed) {
+        PopulationParams p;
+        p.kind = PopulationKind::ProtoplanetaryDisk;
+        p.count = count; p.seed = seed;
+        p.innerRadius = 0.5 * 1.496e11;
+        p.outerRadius = 40.0 * 1.496e11;
+        p.densityIndex = 1.0;
+        p.eccentricitySigma = 0.0;
+        p.inclinationSigma = 0.0;
+        return p;
+    }
+
+    static PopulationParams plummerCluster(int count, uint64_t seed) {
+        PopulationParams p;
+        p.kind = PopulationKind::PlummerCluster;
+        p.count = count; p.seed = seed;
+        p.clusterMass = count * 1.989e30;
+        p.bodyDensity = 1410.0; // Звезды солнечного типа
+        return p;
+    }
+};
+
+struct GeneratedPopulation {
+    std::vector<double> masses;
+    std::vector<double> radii;
+    std::vector<Eigen::Vector3d> positions;
+    std::vector<Eigen::Vector3d> velocities;
+
+    int size() const { return (int)masses.size(); }
+
+    void appendTo(NBodyEngine& engine) const {
+        for (int i = 0; i < size(); ++i) engine.addBody(masses[i], positions[i], velocities[i]);
+    }
+};
+
+namespace scenario_gen {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kTwoPi = 2.0 * kPi;
+
+// SplitMix64: быстрый, без состояния кроме счетчика — удобно заводить на каждое тело
+class Rng {
+public:
+    Rng(uint64_t seed, uint64_t index) : m_state(mix(seed ^ mix(index + 0x9E3779B97F4A7C15ull))) {}
+
+    uint64_t next() {
+        m_state += 0x9E3779B97F4A7C15ull;
+        return mix(m_state);
+    }
+
+    // (0, 1): без нуля, чтобы log и степени были конечны
+    double uniform() { return ((next() >> 11) + 0.5) * (1.0 / 9007199254740992.0); }
+    double uniform(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+    double rayleigh(double sigma) { return sigma * std::sqrt(-2.0 * std::log(uniform())); }
+    double gaussian() { return std::sqrt(-2.0 * std::log(uniform())) * std::cos(kTwoPi * uniform()); }
+
+    Eigen::Vector3d isotropic() {
+        double z = uniform(-1.0, 1.0);
+        double phi = kTwoPi * uniform();
+        double s = std::sqrt(1.0 - z * z);
+        return Eigen::Vector3d(s * std::cos(phi), s * std::sin(phi), z);
+    }
+
+private:
+    uint64_t m_state;
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+// Радиус с поверхностной плотностью ~ r^-p: pdf(r) ~ r^(1-p), обратная функция распределения
+inline double sampleRadius(Rng& rng, double r0, double r1, double p) {
+    const double u = rng.uniform();
+    const double k = 2.0 - p;
+    if (std::fabs(k) < 1e-9) return r0 * std::pow(r1 / r0, u);
+    return std::pow(std::pow(r0, k) + u * (std::pow(r1, k) - std::pow(r0, k)), 1.0 / k);
+}
+
+// Степенной закон масс dN/dm ~ m^-alpha
+inline double sampleMass(Rng& rng, double m0, double m1, double alpha) {
+    if (m1 <= m0) return m0;
+    const double u = rng.uniform();
+    const double k = 1.0 - alpha;
+    if (std::fabs(k) < 1e-9) return m0 * std::pow(m1 / m0, u);
+    return std::pow(std::pow(m0, k) + u * (std::pow(m1, k) - std::pow(m0, k)), 1.0 / k);
+}
+
+// Кеплеровы элементы -> положение и скорость относительно центра
+inline void keplerToState(double mu, double a, double e, double inc, double node, double peri, double meanAnomaly,
+                          Eigen::Vector3d& pos, Eigen::Vector3d& vel) {
+    // Уравнение Кеплера E - e sin E = M (Ньютон)
+    double E = (e < 0.8) ? meanAnomaly : kPi;
+    for (int it = 0; it < 30; ++it) {
+        double f = E - e * std::sin(E) - meanAnomaly;
+        double d = f / (1.0 - e * std::cos(E));
+        E -= d;
+        if (std::fabs(d) < 1e-14) break;
+    }
+
+    const double cosE = std::cos(E), sinE = std::sin(E);
+    const double b = a * std::sqrt(1.0 - e * e);
+    const double n = std::sqrt(mu / (a * a * a));
+    const double rdot = n * a / (1.0 - e * cosE);
+
+    // В плоскости орбиты (перицентр по оси x)
+    const Eigen::Vector3d p(a * (cosE - e), b * sinE, 0.0);
+    const Eigen::Vector3d v(-rdot * sinE, rdot * std::sqrt(1.0 - e * e) * cosE, 0.0);
+
+    const Eigen::Matrix3d rot = (Eigen::AngleAxisd(node, Eigen::Vector3d::UnitZ())
+                               * Eigen::AngleAxisd(inc, Eigen::Vector3d::UnitX())
+                               * Eigen::AngleAxisd(peri, Eigen::Vector3d::UnitZ())).toRotationMatrix();
+    pos = rot * p;
+    vel = rot * v;
+}
+
+// Функция распределения массы диска внутри r (для скорости круговой орбиты)
+inline double diskMassInside(const PopulationParams& prm, double r) {
+    const double k = 2.0 - prm.densityIndex;
+    auto F = [&](double x) { return (std::fabs(k) < 1e-9) ? std::log(x) : std::pow(x, k) / k; };
+    const double rr = std::clamp(r, prm.innerRadius, prm.outerRadius);
+    return prm.diskMass * (F(rr) - F(prm.innerRadius)) / (F(prm.outerRadius) - F(prm.innerRadius));
+}
+
+inline void generateBody(const PopulationParams& prm, int i, GeneratedPopulation& out) {
+    Rng rng(prm.seed, (uint64_t)i);
+    const double G = NBodyEngine::G;
+    Eigen::Vector3d pos, vel;
+    double mass;
+
+    switch (prm.kind) {
+    case PopulationKind::AsteroidBelt:
+    case PopulationKind::KuiperBelt: {
+        mass = sampleMass(rng, prm.minMass, prm.maxMass, prm.massIndex);
+        double a;
+        if (prm.kind == PopulationKind::KuiperBelt && rng.uniform() < prm.resonantFraction) {
+            a = prm.resonantRadius * (1.0 + 0.002 * rng.gaussian()); // Узкий резонанс 3:2
+        } else {
+            a = sampleRadius(rng, prm.innerRadius, prm.outerRadius, prm.densityIndex);
+        }
+        double e = std::min(0.9, rng.rayleigh(prm.eccentricitySigma));
+        double inc = std::min(kPi / 2, rng.rayleigh(prm.inclinationSigma));
+        keplerToState(G * (prm.centralMass + mass), a, e, inc,
+                      kTwoPi * rng.uniform(), kTwoPi * rng.uniform(), kTwoPi * rng.uniform(), pos, vel);
+        break;
+    }
+    case PopulationKind::ProtoplanetaryDisk: {
+        // Равные массы, круговые орбиты вокруг звезды + массы диска внутри r
+        mass = prm.diskMass / prm.count;
+        double r = sampleRadius(rng, prm.innerRadius, prm.outerRadius, prm.densityIndex);
+        double phi = kTwoPi * rng.uniform();
+        double z = prm.aspectRatio * r * rng.gaussian();
+        double vc = std::sqrt(G * (prm.centralMass + diskMassInside(prm, r)) / r);
+        // Небольшая дисперсия скоростей ~ h/r * vc, чтобы диск не был "холодным"
+        double sigma = 0.5 * prm.aspectRatio * vc;
+        pos = Eigen::Vector3d(r * std::cos(phi), r * std::sin(phi), z);
+        vel = Eigen::Vector3d(-vc * std::sin(phi), vc * std::cos(phi), 0.0)
+            + sigma * Eigen::Vector3d(rng.gaussian(), rng.gaussian(), 0.5 * rng.gaussian());
+        break;
+    }
+    case PopulationKind::PlummerCluster:
+    default: {
+        // Aarseth, Henon & Wielen (1974)
+        mass = prm.clusterMass / prm.count;
+        const double a = prm.scaleRadius;
+        double x;
+        do { x = rng.uniform(); } while (x > 0.999); // Обрезаем далекий хвост
+        double r = a / std::sqrt(std::pow(x, -2.0 / 3.0) - 1.0);
+        pos = r * rng.isotropic();
+
+        // q = v / v_escape из g(q) = q^2 (1 - q^2)^3.5 (выборка с отклонением)
+        double q, y;
+        do {
+            q = rng.uniform();
+            y = 0.1 * rng.uniform();
+        } while (y > q * q * std::pow(1.0 - q * q, 3.5));
+        double vEscape = std::sqrt(2.0 * G * prm.clusterMass / std::sqrt(r * r + a * a));
+        vel = q * vEscape * rng.isotropic();
+        break;
+    }
+    }
+
+    out.masses[i] = mass;
+    out.radii[i] = std::cbrt(3.0 * mass / (4.0 * kPi * prm.bodyDensity));
+    if (prm.kind != PopulationKind::PlummerCluster) {
+        pos += prm.centerPosition;
+        vel += prm.centerVelocity;
+    }
+    out.positions[i] = pos;
+    out.velocities[i] = vel;
+}
+
+} // namespace scenario_gen
+
+// Параллельная детерминированная генерация популяции
+inline GeneratedPopulation generatePopulation(const PopulationParams& prm) {
+    GeneratedPopulation out;
+    const int n = std::max(0, prm.count);
+    out.masses.resize(n);
+    out.radii.resize(n);
+    out.positions.resize(n);
+    out.velocities.resize(n);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; ++i) {
+        scenario_gen::generateBody(prm, i, out);
+    }
+
+    // Скопление — в систему центра масс. Суммы по фиксированным блокам
+    // складываются последовательно: результат не зависит от числа потоков.
+    if (prm.kind == PopulationKind::PlummerCluster && n > 0) {
+        const int block = 4096;
+        const int blocks = (n + block - 1) / block;
+        std::vector<Eigen::Vector3d> sumP(blocks, Eigen::Vector3d::Zero()), sumV(blocks, Eigen::Vector3d::Zero());
+        std::vector<double> sumM(blocks, 0.0);
+
+        #pragma omp parallel for schedule(static)
+        for (int b = 0; b < blocks; ++b) {
+            for (int i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+                sumP[b] += out.masses[i] * out.positions[i];
+                sumV[b] += out.masses[i] * out.velocities[i];
+                sumM[b] += out.masses[i];
+            }
+        }
+
+        Eigen::Vector3d P = Eigen::Vector3d::Zero(), V = Eigen::Vector3d::Zero();
+        double M = 0.0;
+        for (int b = 0; b < blocks; ++b) { P += sumP[b]; V += sumV[b]; M += sumM[b]; }
+        const Eigen::Vector3d shiftP = prm.centerPosition - P / M;
+        const Eigen::Vector3d shiftV = prm.centerVelocity - V / M;
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; ++i) {
+            out.positions[i] += shiftP;
+            out.velocities[i] += shiftV;
+        }
+    }
+    return out;
+}
+
+inline const char* populationName(PopulationKind kind) {
+    switch (kind) {
+    case PopulationKind::AsteroidBelt: return "Asteroid";
+    case PopulationKind::KuiperBelt: return "KBO";
+    case PopulationKind::ProtoplanetaryDisk: return "Planetesimal";
+    case PopulationKind::PlummerCluster: return "Star";
+    }
+    return "Body";
+}
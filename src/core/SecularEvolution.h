@@ -0,0 +1,422 @@
+#pragma once
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Dense>
+#include "NBodyEngine.h"
+#include "ScenarioGenerator.h" // scenario_gen::keplerToState
+
+// Вековой режим: орбиты усреднены по быстрым углам, эволюционируют только
+// эксцентриситеты, перицентры, наклоны и узлы (теория Лапласа—Лагранжа,
+// Murray & Dermott, гл. 7). Решение замкнутое — суперпозиция собственных мод,
+// поэтому шаг любой длины стоит одинаково: миллион лет считается так же
+// быстро, как сутки.
+//
+// Роли тел:
+//  - центральное (самое массивное);
+//  - планеты (масса >= minPlanetMass): матрицы A и B по всем парам;
+//  - частицы (легче): свободные колебания + вынужденные от мод планет;
+//  - спутники (parentOf >= 0): кеплерова орбита вокруг родителя, идет только долгота.
+// Большие полуоси постоянны, средние долготы идут со средним движением —
+// по ним восстанавливаются полные векторы состояния для передачи обратно в N-body.
+class SecularEvolution {
+public:
+    using Complex = std::complex<double>;
+
+    // Усредненные элементы тела на текущий момент (в плоскости Лапласа системы)
+    struct Elements {
+        double a = 0.0, e = 0.0, inc = 0.0;
+        double node = 0.0, perihelion = 0.0; // Долгота узла и долгота перицентра
+        double meanLongitude = 0.0;
+    };
+
+    // Снимок состояния движка. false — пусто, незамкнутые или
+    // ретроградные орбиты (для них теория неприменима)
+    bool initialize(const NBodyEngine& engine, double minPlanetMass = 1e20) {
+        m_orbits.clear();
+        m_planets.clear();
+        m_particles.clear();
+        m_time = 0.0;
+        const int n = engine.size();
+        if (n < 2) return false;
+
+        m_central = 0;
+        for (int i = 1; i < n; ++i) if (engine.masses[i] > engine.masses[m_central]) m_central = i;
+        m_startTime = engine.time;
+        m_size = n;
+        const double G = NBodyEngine::G;
+        const double mc = engine.masses[m_central];
+        m_centralMass = mc;
+
+        // Барицентр и плоскость Лапласа (по полному моменту импульса)
+        m_totalMass = 0.0;
+        m_baryPos.setZero();
+        m_baryVel.setZero();
+        for (int i = 0; i < n; ++i) {
+            m_totalMass += engine.masses[i];
+            m_baryPos += engine.masses[i] * engine.positions[i];
+            m_baryVel += engine.masses[i] * engine.velocities[i];
+        }
+        m_baryPos /= m_totalMass;
+        m_baryVel /= m_totalMass;
+        Eigen::Vector3d L = Eigen::Vector3d::Zero();
+        for (int i = 0; i < n; ++i)
+            L += engine.masses[i] * (engine.positions[i] - m_baryPos).cross(engine.velocities[i] - m_baryVel);
+        m_toLaplace = Eigen::Matrix3d::Identity();
+        if (L.norm() > 0.0) {
+            m_toLaplace = Eigen::Quaterniond::FromTwoVectors(L.normalized(), Eigen::Vector3d::UnitZ()).toRotationMatrix();
+        }
+
+        // Элементы всех тел, кроме центрального
+        m_orbits.resize(n);
+        for (int i = 0; i < n; ++i) {
+            Orbit& o = m_orbits[i];
+            if (i == m_central) { o.role = Role::Central; continue; }
+            const int parent = engine.parentOf(i);
+            Eigen::Vector3d r, v;
+            if (parent >= 0 && parent != m_central) {
+                o.role = Role::Moon;
+                o.parent = parent;
+                o.mu = G * (engine.masses[parent] + engine.masses[i]);
+                r = engine.positions[i] - engine.positions[parent];
+                v = engine.velocities[i] - engine.velocities[parent];
+            } else {
+                o.role = (engine.masses[i] >= minPlanetMass) ? Role::Planet : Role::Particle;
+                o.mu = G * (mc + engine.masses[i]);
+                r = m_toLaplace * (engine.positions[i] - engine.positions[m_central]);
+                v = m_toLaplace * (engine.velocities[i] - engine.velocities[m_central]);
+            }
+            Elements el;
+            if (!stateToElements(o.mu, r, v, el)) return false;
+            if (o.role != Role::Moon && el.inc > 0.5 * kPi) return false;
+            o.mass = engine.masses[i];
+            o.a = el.a;
+            o.n = std::sqrt(o.mu / (el.a * el.a * el.a));
+            o.lambda0 = el.meanLongitude;
+            o.z0 = std::polar(el.e, el.perihelion);  // k + i h
+            o.zeta0 = std::polar(el.inc, el.node);   // q + i p
+            if (o.role == Role::Planet) { o.slot = (int)m_planets.size(); m_planets.push_back(i); }
+            if (o.role == Role::Particle) { o.slot = (int)m_particles.size(); m_particles.push_back(i); }
+        }
+        for (int i = 0; i < n; ++i) {
+            // Спутник спутника — вне модели
+            if (m_orbits[i].role == Role::Moon && m_orbits[m_orbits[i].parent].role == Role::Moon) return false;
+        }
+
+        buildPlanetModes();
+        buildParticleForcing();
+        return true;
+    }
+
+    double time() const { return m_time; }          // С момента initialize, с
+    double absoluteTime() const { return m_startTime + m_time; }
+    void advance(double dt) { m_time += dt; }
+
+    // Частоты собственных мод планет, рад/с: g — эксцентриситеты, f — наклоны
+    const Eigen::VectorXd& eccentricityFrequencies() const { return m_g; }
+    const Eigen::VectorXd& inclinationFrequencies() const { return m_f; }
+
+    Elements elements(int body) const {
+        const Orbit& o = m_orbits[body];
+        Elements el;
+        if (o.role == Role::Central) return el;
+        const Complex z = eccentricityVector(body), zeta = inclinationVector(body);
+        el.a = o.a;
+        el.e = std::abs(z);
+        el.perihelion = std::arg(z);
+        el.inc = std::abs(zeta);
+        el.node = std::arg(zeta);
+        el.meanLongitude = o.lambda0 + o.n * m_time;
+        return el;
+    }
+
+    // Передача в N-body: положения, скорости и ускорения на текущий момент + время
+    bool writeState(NBodyEngine& engine) const {
+        if (engine.size() != m_size) return false;
+        const Eigen::Matrix3d fromLaplace = m_toLaplace.transpose();
+
+        // Гелиоцентрические состояния; спутники — поверх родителя
+        std::vector<Eigen::Vector3d> rel(m_size, Eigen::Vector3d::Zero()), relVel(m_size, Eigen::Vector3d::Zero());
+        for (int pass = 0; pass < 2; ++pass) {
+            #pragma omp parallel for schedule(static) if (m_size >= kParallelMinBodies)
+            for (int i = 0; i < m_size; ++i) {
+                const Orbit& o = m_orbits[i];
+                if (o.role == Role::Central || (o.role == Role::Moon) != (pass == 1)) continue;
+                const Elements el = elements(i);
+                Eigen::Vector3d r, v;
+                scenario_gen::keplerToState(o.mu, el.a, el.e, el.inc, el.node, el.perihelion - el.node,
+                                            el.meanLongitude - el.perihelion, r, v);
+                if (o.role == Role::Moon) {
+                    rel[i] = rel[o.parent] + r;
+                    relVel[i] = relVel[o.parent] + v;
+                } else {
+                    rel[i] = fromLaplace * r;
+                    relVel[i] = fromLaplace * v;
+                }
+            }
+        }
+
+        // Центральное тело — так, чтобы барицентр шел равномерно и прямолинейно
+        Eigen::Vector3d sumR = Eigen::Vector3d::Zero(), sumV = Eigen::Vector3d::Zero();
+        for (int i = 0; i < m_size; ++i) {
+            sumR += m_orbits[i].mass * rel[i];
+            sumV += m_orbits[i].mass * relVel[i];
+        }
+        const Eigen::Vector3d centralPos = m_baryPos + m_baryVel * m_time - sumR / m_totalMass;
+        const Eigen::Vector3d centralVel = m_baryVel - sumV / m_totalMass;
+        for (int i = 0; i < m_size; ++i) {
+            engine.positions[i] = centralPos + rel[i];
+            engine.velocities[i] = centralVel + relVel[i];
+        }
+
+        // Двухтельные ускорения (центр и родитель спутника) — для показа;
+        // полные O(N^2) ядро пересчитает перед следующим шагом
+        const double G = NBodyEngine::G;
+        auto pull = [G](double mass, const Eigen::Vector3d& r) -> Eigen::Vector3d {
+            const double d = r.norm();
+            return -G * mass * r / (d * d * d);
+        };
+        Eigen::Vector3d centralAcc = Eigen::Vector3d::Zero();
+        for (int i = 0; i < m_size; ++i) {
+            if (m_orbits[i].role == Role::Central) continue;
+            centralAcc -= pull(m_orbits[i].mass, rel[i]);
+            if (m_orbits[i].role != Role::Moon) engine.accelerations[i] = pull(m_centralMass, rel[i]);
+        }
+        engine.accelerations[m_central] = centralAcc;
+        for (int i = 0; i < m_size; ++i) {
+            const Orbit& o = m_orbits[i];
+            if (o.role == Role::Moon)
+                engine.accelerations[i] = engine.accelerations[o.parent] + pull(m_orbits[o.parent].mass, rel[i] - rel[o.parent]);
+        }
+        engine.time = absoluteTime();
+        engine.invalidateAccelerations();
+        return true;
+    }
+
+    // Кеплеровы элементы по относительному состоянию; false — орбита незамкнута
+    static bool stateToElements(double mu, const Eigen::Vector3d& r, const Eigen::Vector3d& v, Elements& el) {
+        const double rn = r.norm();
+        const Eigen::Vector3d h = r.cross(v);
+        const double energy = 0.5 * v.squaredNorm() - mu / rn;
+        if (!(energy < 0.0) || h.norm() == 0.0) return false;
+        el.a = -mu / (2.0 * energy);
+        const Eigen::Vector3d ev = v.cross(h) / mu - r / rn;
+        el.e = ev.norm();
+        if (el.e >= 1.0) return false;
+        el.inc = std::atan2(std::hypot(h.x(), h.y()), h.z());
+        el.node = (el.inc > 1e-14) ? std::atan2(h.x(), -h.y()) : 0.0;
+
+        // Углы отсчитываются от линии узлов в плоскости орбиты
+        const Eigen::Vector3d nodeDir(std::cos(el.node), std::sin(el.node), 0.0);
+        const Eigen::Vector3d hn = h.normalized();
+        const double peri = (el.e > 1e-14) ? std::atan2(hn.dot(nodeDir.cross(ev)), nodeDir.dot(ev)) : 0.0;
+        const double trueLongitude = std::atan2(hn.dot(nodeDir.cross(r)), nodeDir.dot(r)); // От узла
+        const double nu = trueLongitude - peri;
+        const double E = 2.0 * std::atan2(std::sqrt(1.0 - el.e) * std::sin(0.5 * nu), std::sqrt(1.0 + el.e) * std::cos(0.5 * nu));
+        const double M = E - el.e * std::sin(E);
+        el.perihelion = el.node + peri;
+        el.meanLongitude = el.perihelion + M;
+        return true;
+    }
+
+    // Коэффициенты Лапласа b_3/2^(1) и b_3/2^(2): b_s^(j)(alpha) = 1/pi * int_0^2pi cos(j psi) /
+    // (1 - 2 alpha cos psi + alpha^2)^s dpsi. Подынтегральное выражение периодично —
+    // правило трапеций сходится как alpha^K, число узлов K подбирается под alpha
+    static void laplaceCoefficients(double alpha, double& b1, double& b2) {
+        const int samples = std::clamp(64 * (int)std::ceil(0.5 / -std::log(alpha)), 64, 8192); // alpha^K ~ e^-32
+        double sum1 = 0.0, sum2 = 0.0;
+        for (int k = 0; k < samples; ++k) {
+            const double c = std::cos(2.0 * kPi * k / samples);
+            const double x = 1.0 - 2.0 * alpha * c + alpha * alpha;
+            const double w = 1.0 / (x * std::sqrt(x));
+            sum1 += c * w;
+            sum2 += (2.0 * c * c - 1.0) * w;
+        }
+        b1 = 2.0 * sum1 / samples;
+        b2 = 2.0 * sum2 / samples;
+    }
+
+private:
+    static constexpr double kPi = 3.14159265358979323846;
+    static constexpr int kParallelMinBodies = 256;
+
+    enum class Role { Central, Planet, Particle, Moon };
+
+    struct Orbit {
+        Role role = Role::Central;
+        int parent = -1;
+        int slot = -1;          // Номер среди планет или частиц
+        double mass = 0.0, mu = 0.0, a = 0.0, n = 0.0, lambda0 = 0.0;
+        Complex z0, zeta0;
+    };
+
+    std::vector<Orbit> m_orbits;
+    std::vector<int> m_planets, m_particles;
+    int m_central = 0, m_size = 0;
+    double m_centralMass = 0.0, m_totalMass = 0.0;
+    double m_startTime = 0.0, m_time = 0.0;
+    Eigen::Vector3d m_baryPos, m_baryVel;
+    Eigen::Matrix3d m_toLaplace;
+
+    // Моды планет: z_j(t) = sum_m V_jm c_m exp(i g_m t)
+    Eigen::VectorXd m_g, m_f;
+    Eigen::MatrixXd m_eccModes, m_incModes; // V (с учетом масштаба sqrt(Lambda))
+    std::vector<Complex> m_eccAmp, m_incAmp;
+
+    // Частицы: собственная частота + вынужденные амплитуды по модам планет
+    struct Forced {
+        double A = 0.0, B = 0.0;
+        Complex freeEcc, freeInc;
+        std::vector<Complex> ecc, inc;
+    };
+    std::vector<Forced> m_forced;
+
+    // alpha * alpha_bar для тела j под действием тела k (Murray & Dermott 7.128)
+    // Почти совпадающие полуоси (коорбитальные тела) теория не описывает —
+    // alpha ограничено, чтобы коэффициенты остались конечными
+    static void pairFactors(double aj, double ak, double& alpha, double& weight) {
+        alpha = std::min(std::min(aj, ak) / std::max(aj, ak), 0.99);
+        weight = (aj < ak) ? alpha * alpha : alpha; // Внешний возмутитель: alpha_bar = alpha
+    }
+
+    // A_jk, B_jk (рад/с) для тела с полуосью a и средним движением n
+    void coefficients(double a, double n, int perturber, double& diagA, double& offA, double& offB) const {
+        const Orbit& p = m_orbits[perturber];
+        double alpha, weight;
+        pairFactors(a, p.a, alpha, weight);
+        const double common = 0.25 * n * p.mass / m_centralMass * weight;
+        double b1, b2;
+        laplaceCoefficients(alpha, b1, b2);
+        diagA = common * b1;
+        offA = -common * b2;
+        offB = common * b1;
+    }
+
+    void buildPlanetModes() {
+        const int np = (int)m_planets.size();
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(np, np), B = Eigen::MatrixXd::Zero(np, np);
+        for (int j = 0; j < np; ++j) {
+            const Orbit& oj = m_orbits[m_planets[j]];
+            for (int k = 0; k < np; ++k) {
+                if (k == j) continue;
+                double diagA, offA, offB;
+                coefficients(oj.a, oj.n, m_planets[k], diagA, offA, offB);
+                A(j, j) += diagA;
+                B(j, j) -= diagA;
+                A(j, k) = offA;
+                B(j, k) = offB;
+            }
+        }
+
+        // Масштаб sqrt(Lambda_j), Lambda = m sqrt(G M a), делает A и B симметричными
+        Eigen::VectorXd scale(np);
+        for (int j = 0; j < np; ++j) {
+            const Orbit& o = m_orbits[m_planets[j]];
+            scale(j) = std::sqrt(o.mass * std::sqrt(NBodyEngine::G * m_centralMass * o.a));
+        }
+        auto modes = [&](const Eigen::MatrixXd& M, Eigen::VectorXd& freq, Eigen::MatrixXd& vectors) {
+            // Без планет (звезда и кометы) мод нет, частицы остаются на своих орбитах
+            if (np == 0) {
+                freq.resize(0);
+                vectors.resize(0, 0);
+                return;
+            }
+            const Eigen::MatrixXd S = scale.asDiagonal() * M * scale.cwiseInverse().asDiagonal();
+            Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(0.5 * (S + S.transpose()));
+            freq = solver.eigenvalues();
+            vectors = solver.eigenvectors();
+        };
+        Eigen::MatrixXd Q, P;
+        modes(A, m_g, Q);
+        modes(B, m_f, P);
+
+        // z = D^-1 Q c,  c = Q^T D z0
+        m_eccModes = scale.cwiseInverse().asDiagonal() * Q;
+        m_incModes = scale.cwiseInverse().asDiagonal() * P;
+        m_eccAmp.assign(np, Complex(0.0));
+        m_incAmp.assign(np, Complex(0.0));
+        for (int m = 0; m < np; ++m) {
+            for (int j = 0; j < np; ++j) {
+                const Orbit& o = m_orbits[m_planets[j]];
+                m_eccAmp[m] += Q(j, m) * scale(j) * o.z0;
+                m_incAmp[m] += P(j, m) * scale(j) * o.zeta0;
+            }
+        }
+    }
+
+    // Частица: z' = i (A z + sum_j A_j z_j(t)). Вынужденный ответ на моду m —
+    // (sum_j A_j V_jm c_m) / (g_m - A); у вековых резонансов знаменатель
+    // ограничен снизу, иначе амплитуда уходит в бесконечность (как и в самой теории)
+    void buildParticleForcing() {
+        const int np = (int)m_planets.size();
+        const int count = (int)m_particles.size();
+        m_forced.assign(count, Forced());
+        #pragma omp parallel for schedule(dynamic, 64) if (count >= kParallelMinBodies)
+        for (int q = 0; q < count; ++q) {
+            const Orbit& o = m_orbits[m_particles[q]];
+            Forced& f = m_forced[q];
+            std::vector<double> Aj(np), Bj(np);
+            for (int j = 0; j < np; ++j) {
+                double diagA, offA, offB;
+                coefficients(o.a, o.n, m_planets[j], diagA, offA, offB);
+                f.A += diagA;
+                f.B -= diagA;
+                Aj[j] = offA;
+                Bj[j] = offB;
+            }
+            f.ecc.assign(np, Complex(0.0));
+            f.inc.assign(np, Complex(0.0));
+            f.freeEcc = o.z0;
+            f.freeInc = o.zeta0;
+            for (int m = 0; m < np; ++m) {
+                Complex driveE(0.0), driveI(0.0);
+                for (int j = 0; j < np; ++j) {
+                    driveE += Aj[j] * m_eccModes(j, m) * m_eccAmp[m];
+                    driveI += Bj[j] * m_incModes(j, m) * m_incAmp[m];
+                }
+                f.ecc[m] = driveE / detuned(m_g(m) - f.A, f.A);
+                f.inc[m] = driveI / detuned(m_f(m) - f.B, f.B);
+                f.freeEcc -= f.ecc[m];
+                f.freeInc -= f.inc[m];
+            }
+        }
+    }
+
+    static double detuned(double delta, double scale) {
+        const double floor = 1e-3 * std::abs(scale) + 1e-30;
+        return (std::abs(delta) < floor) ? std::copysign(floor, delta) : delta;
+    }
+
+    // k + i h тела на момент m_time
+    Complex eccentricityVector(int body) const {
+        const Orbit& o = m_orbits[body];
+        if (o.role == Role::Moon) return o.z0;
+        if (o.role == Role::Planet) {
+            Complex z(0.0);
+            for (int m = 0; m < m_g.size(); ++m)
+                z += m_eccModes(o.slot, m) * m_eccAmp[m] * std::polar(1.0, m_g(m) * m_time);
+            return z;
+        }
+        const Forced& f = m_forced[o.slot];
+        Complex z = f.freeEcc * std::polar(1.0, f.A * m_time);
+        for (int m = 0; m < m_g.size(); ++m) z += f.ecc[m] * std::polar(1.0, m_g(m) * m_time);
+        return z;
+    }
+
+    // q + i p тела на момент m_time
+    Complex inclinationVector(int body) const {
+        const Orbit& o = m_orbits[body];
+        if (o.role == Role::Moon) return o.zeta0;
+        if (o.role == Role::Planet) {
+            Complex z(0.0);
+            for (int m = 0; m < m_f.size(); ++m)
+                z += m_incModes(o.slot, m) * m_incAmp[m] * std::polar(1.0, m_f(m) * m_time);
+            return z;
+        }
+        const Forced& f = m_forced[o.slot];
+        Complex z = f.freeInc * std::polar(1.0, f.B * m_time);
+        for (int m = 0; m < m_f.size(); ++m) z += f.inc[m] * std::polar(1.0, m_f(m) * m_time);
+        return z;
+    }
+};
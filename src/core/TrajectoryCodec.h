@@ -0,0 +1,485 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <omp.h>
+
+// Сжатие траекторий (формат .strj).
+//
+// 1. Квантование: позиция округляется на решетку с шагом q = 2 * maxError / sqrt(3),
+//    Q = round(x / q). Ошибка по оси <= q/2, по модулю вектора <= maxError.
+// 2. Предсказание в целых числах по уже закодированным кадрам того же тела:
+//    Q[k-1] (кадр 1), 2Q[k-1]-Q[k-2] (кадр 2), 3Q[k-1]-3Q[k-2]+Q[k-3] (дальше).
+//    Целочисленная арифметика делает декодер бит-в-бит равным кодеру.
+// 3. Остаток -> zigzag -> адаптивный код Райса (k по скользящему среднему, как в
+//    JPEG-LS), поэтому кодирование идет потоком, без буферизации кадров.
+// 4. Чанки по chunkFrames кадров декодируются независимо; индекс чанков в конце
+//    файла дает переход к любому кадру.
+//
+// Тела кодируются независимо (отдельный битовый поток на тело) — параллельно.
+// Порядок байт — little-endian (x86/ARM).
+
+namespace strj {
+
+constexpr char kMagic[4] = {'S', 'T', 'R', 'J'};
+constexpr char kChunkMagic[4] = {'C', 'H', 'N', 'K'};
+constexpr char kIndexMagic[4] = {'S', 'I', 'D', 'X'};
+constexpr uint32_t kVersion = 1;
+
+// Для больших тел ветвление по потокам окупается
+constexpr int kParallelMinBodies = 512;
+
+// --- Битовый поток ---
+class BitWriter {
+public:
+    std::vector<uint8_t> bytes;
+
+    void write(uint64_t value, int bits) {
+        while (bits > 0) {
+            // Порциями по 32 бита: в аккумуляторе остается < 8 бит, переполнения нет
+            int take = std::min(bits, 32);
+            m_acc |= (value & ((1ull << take) - 1)) << m_fill;
+            m_fill += take;
+            value >>= take;
+            bits -= take;
+            while (m_fill >= 8) {
+                bytes.push_back((uint8_t)(m_acc & 0xFF));
+                m_acc >>= 8;
+                m_fill -= 8;
+            }
+        }
+    }
+
+    void writeOnes(int count) {
+        while (count > 0) {
+            int take = std::min(count, 32);
+            write((1ull << take) - 1, take);
+            count -= take;
+        }
+    }
+
+    void flush() {
+        if (m_fill > 0) bytes.push_back((uint8_t)(m_acc & 0xFF));
+        m_acc = 0;
+        m_fill = 0;
+    }
+
+    void clear() {
+        bytes.clear();
+        m_acc = 0;
+        m_fill = 0;
+    }
+
+private:
+    uint64_t m_acc = 0;
+    int m_fill = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    uint64_t read(int bits) {
+        uint64_t value = 0;
+        int shift = 0;
+        while (bits > 0) {
+            refill();
+            int take = std::min(std::min(bits, m_fill), 32);
+            if (take == 0) { m_overrun = true; return value; }
+            value |= (m_acc & ((1ull << take) - 1)) << shift;
+            m_acc >>= take;
+            m_fill -= take;
+            shift += take;
+            bits -= take;
+        }
+        return value;
+    }
+
+    int countOnes(int limit) {
+        int n = 0;
+        while (n < limit && read(1) == 1) ++n;
+        return n;
+    }
+
+    bool overrun() const { return m_overrun; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    uint64_t m_acc = 0;
+    int m_fill = 0;
+    bool m_overrun = false;
+
+    void refill() {
+        while (m_fill <= 56 && m_pos < m_size) {
+            m_acc |= (uint64_t)m_data[m_pos++] << m_fill;
+            m_fill += 8;
+        }
+    }
+};
+
+// --- Адаптивный код Райса ---
+// Параметр k — наименьший, при котором count * 2^k >= sum(|u|).
+struct RiceState {
+    uint64_t sum = 4;
+    uint32_t count = 1;
+
+    int k() const {
+        int k = 0;
+        while (k < 62 && ((uint64_t)count << k) < sum) ++k;
+        return k;
+    }
+
+    void update(uint64_t u) {
+        sum += u;
+        if (++count >= 64) { sum = (sum + 1) / 2; count /= 2; }
+    }
+};
+
+constexpr int kEscapeOnes = 20; // Длиннее — пишем значение целиком
+
+inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t unzigzag(uint64_t u) { return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+
+inline void writeRice(BitWriter& w, RiceState& st, int64_t residual) {
+    const uint64_t u = zigzag(residual);
+    const int k = st.k();
+    const uint64_t q = u >> k;
+    if (q < (uint64_t)kEscapeOnes) {
+        w.writeOnes((int)q);
+        w.write(0, 1);
+        w.write(u, k);
+    } else {
+        int bits = 1;
+        while (bits < 64 && (u >> bits) != 0) ++bits;
+        w.writeOnes(kEscapeOnes);
+        w.write((uint64_t)(bits - 1), 6);
+        w.write(u, bits);
+    }
+    st.update(u);
+}
+
+inline int64_t readRice(BitReader& r, RiceState& st) {
+    const int k = st.k();
+    const int q = r.countOnes(kEscapeOnes);
+    uint64_t u;
+    if (q < kEscapeOnes) {
+        u = ((uint64_t)q << k) | r.read(k);
+    } else {
+        int bits = (int)r.read(6) + 1;
+        u = r.read(bits);
+    }
+    st.update(u);
+    return unzigzag(u);
+}
+
+// Состояние одного тела внутри чанка (одинаково у кодера и декодера)
+struct BodyPredictor {
+    int64_t history[3][3] = {}; // [кадр назад][ось]
+    int frames = 0;
+    RiceState rice[3];
+
+    int64_t predict(int axis) const {
+        if (frames == 1) return history[0][axis];
+        if (frames == 2) return 2 * history[0][axis] - history[1][axis];
+        return 3 * history[0][axis] - 3 * history[1][axis] + history[2][axis];
+    }
+
+    void push(const int64_t q[3]) {
+        for (int a = 0; a < 3; ++a) {
+            history[2][a] = history[1][a];
+            history[1][a] = history[0][a];
+            history[0][a] = q[a];
+        }
+        ++frames;
+    }
+};
+
+template <typename T>
+void writePod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readPod(std::istream& in, T& value) {
+    return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+struct ChunkInfo {
+    uint64_t offset;
+    uint64_t firstFrame;
+    uint32_t frameCount;
+};
+
+// Заголовок файла: магия, версия, число тел, кадров в чанке, maxError, шаг решетки
+constexpr uint64_t kHeaderBytes = 4 + 3 * sizeof(uint32_t) + 2 * sizeof(double);
+// Хвост: смещение индекса + магия
+constexpr uint64_t kTailBytes = sizeof(uint64_t) + 4;
+constexpr uint64_t kIndexEntryBytes = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+// Меньше чанк быть не может: магия, число кадров, времена, размеры потоков
+// и опорный кадр (3 x int64) каждого тела
+inline uint64_t minChunkBytes(uint64_t bodies, uint64_t frames) {
+    return 4 + sizeof(uint32_t) + frames * sizeof(double) + bodies * (sizeof(uint32_t) + 3 * sizeof(int64_t));
+}
+
+} // namespace strj
+
+// Потоковый кодер: addFrame после каждого шага, finish в конце записи
+class TrajectoryEncoder {
+public:
+    TrajectoryEncoder(std::ostream& out, int bodyCount, double maxError, int chunkFrames = 256)
+        : m_out(out), m_bodyCount(bodyCount), m_maxError(maxError),
+          m_step(2.0 * maxError / std::sqrt(3.0)), m_chunkFrames(chunkFrames),
+          m_writers(bodyCount), m_predictors(bodyCount) {
+        m_out.write(strj::kMagic, 4);
+        strj::writePod(m_out, strj::kVersion);
+        strj::writePod(m_out, (uint32_t)m_bodyCount);
+        strj::writePod(m_out, (uint32_t)m_chunkFrames);
+        strj::writePod(m_out, m_maxError);
+        strj::writePod(m_out, m_step);
+    }
+
+    // positions: double[3 * bodyCount]. false — координата не помещается на решетку.
+    bool addFrame(double time, const double* positions) {
+        const int n = m_bodyCount;
+        const double inv = 1.0 / m_step;
+        bool ok = true;
+
+        #pragma omp parallel for schedule(static) if(n >= strj::kParallelMinBodies) reduction(&&:ok)
+        for (int b = 0; b < n; ++b) {
+            int64_t q[3];
+            for (int a = 0; a < 3; ++a) {
+                double scaled = positions[3 * b + a] * inv;
+                // Запас 2^60: предсказание 3Q не переполнит int64
+                if (!(std::fabs(scaled) < 1.15e18)) { ok = false; scaled = 0.0; }
+                q[a] = (int64_t)std::llround(scaled);
+            }
+
+            strj::BitWriter& w = m_writers[b];
+            strj::BodyPredictor& p = m_predictors[b];
+            if (p.frames == 0) {
+                for (int a = 0; a < 3; ++a) w.write((uint64_t)q[a], 64); // Опорный кадр чанка
+            } else {
+                for (int a = 0; a < 3; ++a) strj::writeRice(w, p.rice[a], q[a] - p.predict(a));
+            }
+            p.push(q);
+        }
+
+        m_times.push_back(time);
+        m_totalFrames++;
+        if ((int)m_times.size() >= m_chunkFrames) flushChunk();
+        return ok;
+    }
+
+    // Дописывает неполный чанк и индекс. После вызова кодер не используется.
+    void finish() {
+        if (m_finished) return;
+        flushChunk();
+
+        const uint64_t indexOffset = (uint64_t)m_out.tellp();
+        m_out.write(strj::kIndexMagic, 4);
+        strj::writePod(m_out, (uint32_t)m_index.size());
+        for (const auto& c : m_index) {
+            strj::writePod(m_out, c.offset);
+            strj::writePod(m_out, c.firstFrame);
+            strj::writePod(m_out, c.frameCount);
+        }
+        strj::writePod(m_out, indexOffset);
+        m_out.write(strj::kMagic, 4);
+        m_out.flush();
+        m_finished = true;
+    }
+
+    ~TrajectoryEncoder() { finish(); }
+
+    uint64_t frameCount() const { return m_totalFrames; }
+    uint64_t bytesWritten() const { return m_bytes; }
+
+private:
+    std::ostream& m_out;
+    int m_bodyCount;
+    double m_maxError;
+    double m_step;
+    int m_chunkFrames;
+
+    std::vector<strj::BitWriter> m_writers;
+    std::vector<strj::BodyPredictor> m_predictors;
+    std::vector<double> m_times;
+    std::vector<strj::ChunkInfo> m_index;
+    uint64_t m_totalFrames = 0;
+    uint64_t m_bytes = 0;
+    bool m_finished = false;
+
+    // Чанк: магия, число кадров, времена, размеры потоков тел, сами потоки
+    void flushChunk() {
+        if (m_times.empty()) return;
+        const uint64_t offset = (uint64_t)m_out.tellp();
+        m_index.push_back({offset, m_totalFrames - m_times.size(), (uint32_t)m_times.size()});
+
+        m_out.write(strj::kChunkMagic, 4);
+        strj::writePod(m_out, (uint32_t)m_times.size());
+        m_out.write(reinterpret_cast<const char*>(m_times.data()), m_times.size() * sizeof(double));
+
+        for (auto& w : m_writers) {
+            w.flush();
+            strj::writePod(m_out, (uint32_t)w.bytes.size());
+        }
+        for (auto& w : m_writers) {
+            m_out.write(reinterpret_cast<const char*>(w.bytes.data()), w.bytes.size());
+            w.clear();
+        }
+        m_bytes = (uint64_t)m_out.tellp();
+
+        // Следующий чанк начинается с чистого состояния — независимое декодирование
+        for (auto& p : m_predictors) p = strj::BodyPredictor();
+        m_times.clear();
+    }
+};
+
+// Декодер с произвольным доступом по индексу чанков
+class TrajectoryDecoder {
+public:
+    explicit TrajectoryDecoder(std::istream& in) : m_in(in) {
+        char magic[4];
+        uint32_t version = 0, bodies = 0, chunkFrames = 0;
+        if (!m_in.read(magic, 4) || std::memcmp(magic, strj::kMagic, 4) != 0) return;
+        if (!strj::readPod(m_in, version) || version != strj::kVersion) return;
+        if (!strj::readPod(m_in, bodies) || !strj::readPod(m_in, chunkFrames)) return;
+        if (!strj::readPod(m_in, m_maxError) || !strj::readPod(m_in, m_step)) return;
+        if (bodies > (uint32_t)INT32_MAX || chunkFrames == 0) return;
+        m_bodyCount = (int)bodies;
+
+        // Все размеры сверяются с длиной файла до выделения памяти:
+        // испорченный заголовок не должен заказать гигабайты
+        m_in.seekg(0, std::ios::end);
+        const std::streamoff end = m_in.tellg();
+        if (end < (std::streamoff)(strj::kHeaderBytes + strj::kTailBytes)) return;
+        const uint64_t fileSize = (uint64_t)end;
+
+        uint64_t indexOffset = 0;
+        m_in.seekg(-(std::streamoff)strj::kTailBytes, std::ios::end);
+        if (!strj::readPod(m_in, indexOffset) || !m_in.read(magic, 4) || std::memcmp(magic, strj::kMagic, 4) != 0) return;
+        if (indexOffset < strj::kHeaderBytes || indexOffset > fileSize - strj::kTailBytes - 8) return;
+
+        m_in.seekg((std::streamoff)indexOffset);
+        uint32_t chunks = 0;
+        if (!m_in.read(magic, 4) || std::memcmp(magic, strj::kIndexMagic, 4) != 0) return;
+        if (!strj::readPod(m_in, chunks)) return;
+        if ((uint64_t)chunks * strj::kIndexEntryBytes != fileSize - strj::kTailBytes - indexOffset - 8) return;
+
+        // Чанки идут подряд, каждый не короче minChunkBytes и целиком до индекса
+        m_index.resize(chunks);
+        uint64_t chunkEnd = strj::kHeaderBytes;
+        for (auto& c : m_index) {
+            strj::readPod(m_in, c.offset);
+            strj::readPod(m_in, c.firstFrame);
+            strj::readPod(m_in, c.frameCount);
+            if (c.offset < chunkEnd || c.offset > indexOffset) return;
+            if (c.firstFrame != m_frameCount || c.frameCount == 0 || c.frameCount > chunkFrames) return;
+            chunkEnd = c.offset + strj::minChunkBytes(bodies, c.frameCount);
+            if (chunkEnd > indexOffset) return;
+            m_frameCount = c.firstFrame + c.frameCount;
+        }
+        m_indexOffset = indexOffset;
+        m_valid = (bool)m_in;
+    }
+
+    bool isValid() const { return m_valid; }
+    int bodyCount() const { return m_bodyCount; }
+    uint64_t frameCount() const { return m_frameCount; }
+    int chunkCount() const { return (int)m_index.size(); }
+    double maxError() const { return m_maxError; }
+    const strj::ChunkInfo& chunk(int c) const { return m_index[c]; }
+
+    // Весь чанк: times[frameCount], positions[frameCount][bodyCount][3]
+    bool decodeChunk(int c, std::vector<double>& times, std::vector<double>& positions) {
+        if (!m_valid || c < 0 || c >= chunkCount()) return false;
+        const strj::ChunkInfo& info = m_index[c];
+        const int n = m_bodyCount;
+        const int frames = (int)info.frameCount;
+
+        char magic[4];
+        uint32_t storedFrames = 0;
+        m_in.clear();
+        m_in.seekg((std::streamoff)info.offset);
+        if (!m_in.read(magic, 4) || std::memcmp(magic, strj::kChunkMagic, 4) != 0) return false;
+        if (!strj::readPod(m_in, storedFrames) || storedFrames != info.frameCount) return false;
+
+        times.resize(frames);
+        m_in.read(reinterpret_cast<char*>(times.data()), frames * sizeof(double));
+
+        std::vector<uint32_t> sizes(n);
+        m_in.read(reinterpret_cast<char*>(sizes.data()), n * sizeof(uint32_t));
+        if (!m_in) return false;
+        std::vector<uint64_t> starts(n + 1, 0);
+        for (int b = 0; b < n; ++b) starts[b + 1] = starts[b] + sizes[b];
+
+        // Потоки тел обязаны уместиться до следующего чанка (или индекса)
+        const uint64_t dataOffset = info.offset + 4 + sizeof(uint32_t) + (uint64_t)frames * sizeof(double) + (uint64_t)n * sizeof(uint32_t);
+        const uint64_t chunkEnd = (c + 1 < chunkCount()) ? m_index[c + 1].offset : m_indexOffset;
+        if (starts[n] > chunkEnd - dataOffset) return false;
+
+        std::vector<uint8_t> data(starts[n]);
+        m_in.read(reinterpret_cast<char*>(data.data()), data.size());
+        if (!m_in) return false;
+
+        positions.resize((size_t)frames * n * 3);
+        const double step = m_step;
+        bool ok = true;
+
+        #pragma omp parallel for schedule(static) if(n >= strj::kParallelMinBodies) reduction(&&:ok)
+        for (int b = 0; b < n; ++b) {
+            strj::BitReader r(data.data() + starts[b], sizes[b]);
+            strj::BodyPredictor p;
+            for (int f = 0; f < frames; ++f) {
+                int64_t q[3];
+                for (int a = 0; a < 3; ++a) {
+                    q[a] = (f == 0) ? (int64_t)r.read(64) : p.predict(a) + strj::readRice(r, p.rice[a]);
+                    positions[((size_t)f * n + b) * 3 + a] = (double)q[a] * step;
+                }
+                p.push(q);
+            }
+            if (r.overrun()) ok = false;
+        }
+        return ok;
+    }
+
+    // Один кадр; последний декодированный чанк кэшируется (последовательное чтение дешево)
+    bool readFrame(uint64_t frame, double& time, std::vector<double>& positions) {
+        if (frame >= m_frameCount) return false;
+        int lo = 0, hi = chunkCount() - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (m_index[mid].firstFrame <= frame) lo = mid; else hi = mid - 1;
+        }
+        if (lo != m_cachedChunk) {
+            if (!decodeChunk(lo, m_cacheTimes, m_cachePositions)) return false;
+            m_cachedChunk = lo;
+        }
+        const size_t f = frame - m_index[lo].firstFrame;
+        const size_t stride = (size_t)m_bodyCount * 3;
+        time = m_cacheTimes[f];
+        positions.assign(m_cachePositions.begin() + f * stride, m_cachePositions.begin() + (f + 1) * stride);
+        return true;
+    }
+
+private:
+    std::istream& m_in;
+    bool m_valid = false;
+    int m_bodyCount = 0;
+    double m_maxError = 0.0;
+    double m_step = 1.0;
+    uint64_t m_frameCount = 0;
+    uint64_t m_indexOffset = 0;
+    std::vector<strj::ChunkInfo> m_index;
+
+    int m_cachedChunk = -1;
+    std::vector<double> m_cacheTimes;
+    std::vector<double> m_cachePositions;
+};
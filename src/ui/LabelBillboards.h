@@ -0,0 +1,349 @@
+#pragma once
+
+#include <Qt3DCore/QEntity>
+#include <Qt3DCore/QGeometry>
+#include <Qt3DCore/QAttribute>
+#include <Qt3DCore/QBuffer>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QMaterial>
+#include <Qt3DRender/QEffect>
+#include <Qt3DRender/QTechnique>
+#include <Qt3DRender/QRenderPass>
+#include <Qt3DRender/QShaderProgram>
+#include <Qt3DRender/QFilterKey>
+#include <Qt3DRender/QParameter>
+#include <Qt3DRender/QGraphicsApiFilter>
+#include <Qt3DRender/QTexture>
+#include <Qt3DRender/QPaintedTextureImage>
+#include <Qt3DRender/QBlendEquation>
+#include <Qt3DRender/QBlendEquationArguments>
+#include <Qt3DRender/QNoDepthMask>
+#include <Qt3DRender/QCullFace>
+#include <QPainter>
+#include <QFont>
+#include <QFontMetrics>
+#include <QStringList>
+#include <QVector3D>
+#include <QByteArray>
+#include <QRect>
+#include <vector>
+#include <cstring>
+
+// Атлас подписей: все имена нарисованы в одну текстуру (полочная упаковка)
+class LabelAtlasImage : public Qt3DRender::QPaintedTextureImage {
+public:
+    explicit LabelAtlasImage(Qt3DCore::QNode* parent = nullptr)
+        : Qt3DRender::QPaintedTextureImage(parent) {
+        m_font.setFamily("Arial");
+        m_font.setBold(true);
+        m_font.setPixelSize(28); // Рисуем крупно — на экране уменьшится без "мыла"
+    }
+
+    // Раскладывает подписи по полкам; возвращает прямоугольник каждой в пикселях
+    // (пустой, если подпись пуста или атлас переполнен).
+    std::vector<QRect> layout(const QStringList& texts) {
+        m_texts = texts;
+        m_rects.assign(texts.size(), QRect());
+
+        QFontMetrics fm(m_font);
+        const int rowHeight = fm.height() + kPadding;
+        int x = 0, y = 0;
+
+        for (int i = 0; i < texts.size(); ++i) {
+            if (texts[i].isEmpty()) continue; // Безымянная мелочь места не занимает
+            int w = fm.horizontalAdvance(texts[i]) + kPadding;
+            if (w > kAtlasWidth) w = kAtlasWidth;
+            if (x + w > kAtlasWidth) { x = 0; y += rowHeight; }
+            if (y + rowHeight > kMaxAtlasHeight) break; // Остальные подписи не влезли
+            m_rects[i] = QRect(x, y, w, rowHeight);
+            x += w;
+        }
+
+        int height = y + rowHeight;
+        if (height > kMaxAtlasHeight) height = kMaxAtlasHeight;
+        setSize(QSize(kAtlasWidth, height));
+        update(); // Перерисовать текстуру
+        return m_rects;
+    }
+
+protected:
+    void paint(QPainter* painter) override {
+        painter->setCompositionMode(QPainter::CompositionMode_Source);
+        painter->fillRect(QRect(QPoint(0, 0), size()), Qt::transparent);
+        painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter->setFont(m_font);
+        painter->setPen(Qt::white);
+        for (int i = 0; i < m_texts.size(); ++i) {
+            if (m_rects[i].isEmpty()) continue;
+            painter->drawText(m_rects[i].adjusted(kPadding / 2, 0, 0, 0), Qt::AlignLeft | Qt::AlignVCenter, m_texts[i]);
+        }
+    }
+
+private:
+    static constexpr int kAtlasWidth = 1024;
+    static constexpr int kMaxAtlasHeight = 4096;
+    static constexpr int kPadding = 4;
+
+    QFont m_font;
+    QStringList m_texts;
+    std::vector<QRect> m_rects;
+};
+
+// Все подписи одной сущностью: инстансинг квада, один draw call.
+// Разворот к камере считается в вершинном шейдере по осям view-матрицы,
+// поэтому на CPU за кадр остается только заливка буфера якорей (N * 12 байт).
+class LabelBillboards : public Qt3DCore::QEntity {
+public:
+    LabelBillboards(Qt3DCore::QEntity* parent, float labelHeight = 12.0f)
+        : Qt3DCore::QEntity(parent), m_labelHeight(labelHeight) {
+
+        // 1. Геометрия: единичный квад + атрибуты на инстанс
+        m_renderer = new Qt3DRender::QGeometryRenderer(this);
+        m_renderer->setPrimitiveType(Qt3DRender::QGeometryRenderer::TriangleStrip);
+        m_renderer->setVertexCount(4);
+        m_renderer->setInstanceCount(0);
+
+        auto geometry = new Qt3DCore::QGeometry(this);
+
+        auto quadBuffer = new Qt3DCore::QBuffer(geometry);
+        const float corners[] = {0, 0,  1, 0,  0, 1,  1, 1};
+        quadBuffer->setData(QByteArray(reinterpret_cast<const char*>(corners), sizeof(corners)));
+        geometry->addAttribute(makeAttribute(geometry, quadBuffer, "vertexCorner", 2, 0, 4));
+
+        // Якоря меняются каждый кадр, прямоугольники — только при смене набора тел
+        m_anchorBuffer = new Qt3DCore::QBuffer(geometry);
+        m_anchorAttribute = makeAttribute(geometry, m_anchorBuffer, "labelAnchor", 3, 1, 0);
+        geometry->addAttribute(m_anchorAttribute);
+
+        m_rectBuffer = new Qt3DCore::QBuffer(geometry);
+        m_uvAttribute = makeAttribute(geometry, m_rectBuffer, "labelUvRect", 4, 1, 0);
+        m_uvAttribute->setByteStride(8 * sizeof(float));
+        m_sizeAttribute = makeAttribute(geometry, m_rectBuffer, "labelRect", 4, 1, 0);
+        m_sizeAttribute->setByteStride(8 * sizeof(float));
+        m_sizeAttribute->setByteOffset(4 * sizeof(float));
+        geometry->addAttribute(m_uvAttribute);
+        geometry->addAttribute(m_sizeAttribute);
+
+        m_renderer->setGeometry(geometry);
+
+        // 2. Текстура-атлас
+        m_atlas = new LabelAtlasImage();
+        m_texture = new Qt3DRender::QTexture2D(this);
+        m_texture->setMinificationFilter(Qt3DRender::QAbstractTexture::Linear);
+        m_texture->setMagnificationFilter(Qt3DRender::QAbstractTexture::Linear);
+        m_texture->addTextureImage(m_atlas);
+
+        // 3. Материал
+        addComponent(m_renderer);
+        addComponent(createMaterial());
+    }
+
+    // Новый набор подписей (при создании/сбросе сцены). Пустой список — нет подписей.
+    void setLabels(const QStringList& names) {
+        m_count = names.size();
+        std::vector<QRect> rects = m_atlas->layout(names);
+        const float atlasW = (float)m_atlas->size().width();
+        const float atlasH = (float)m_atlas->size().height();
+
+        // На инстанс: uv (u0, vНиз, u1, vВерх) + смещение и размер в мировых единицах
+        QByteArray data;
+        data.resize(m_count * 8 * sizeof(float));
+        float* raw = reinterpret_cast<float*>(data.data());
+        for (int i = 0; i < m_count; ++i) {
+            const QRect& r = rects[i];
+            const float height = r.isEmpty() ? 0.0f : m_labelHeight;
+            const float width = r.isEmpty() ? 0.0f : m_labelHeight * r.width() / (float)r.height();
+            *raw++ = r.left() / atlasW;
+            *raw++ = (r.top() + r.height()) / atlasH;
+            *raw++ = (r.left() + r.width()) / atlasW;
+            *raw++ = r.top() / atlasH;
+            *raw++ = 5.0f;   // Смещение от центра тела, как у прежних подписей
+            *raw++ = 10.0f;
+            *raw++ = width;
+            *raw++ = height;
+        }
+        m_rectBuffer->setData(data);
+        m_uvAttribute->setCount(m_count);
+        m_sizeAttribute->setCount(m_count);
+
+        m_anchorData.resize(m_count * 3 * sizeof(float));
+        m_anchorData.fill(0);
+        m_anchorBuffer->setData(m_anchorData);
+        m_anchorAttribute->setCount(m_count);
+
+        m_renderer->setInstanceCount(m_count);
+    }
+
+    // Позиции тел в координатах сцены (одна загрузка буфера на кадр)
+    void setAnchors(const std::vector<QVector3D>& anchors) {
+        if ((int)anchors.size() != m_count || m_count == 0) return;
+        static_assert(sizeof(QVector3D) == 3 * sizeof(float), "QVector3D must be packed");
+        std::memcpy(m_anchorData.data(), anchors.data(), m_anchorData.size());
+        m_anchorBuffer->setData(m_anchorData);
+    }
+
+private:
+    float m_labelHeight;
+    int m_count = 0;
+    QByteArray m_anchorData;
+
+    Qt3DRender::QGeometryRenderer* m_renderer;
+    Qt3DCore::QBuffer* m_anchorBuffer;
+    Qt3DCore::QBuffer* m_rectBuffer;
+    Qt3DCore::QAttribute* m_anchorAttribute;
+    Qt3DCore::QAttribute* m_uvAttribute;
+    Qt3DCore::QAttribute* m_sizeAttribute;
+    LabelAtlasImage* m_atlas;
+    Qt3DRender::QTexture2D* m_texture;
+
+    static Qt3DCore::QAttribute* makeAttribute(Qt3DCore::QGeometry* geometry, Qt3DCore::QBuffer* buffer,
+                                               const QString& name, uint size, uint divisor, uint count) {
+        auto attr = new Qt3DCore::QAttribute(geometry);
+        attr->setName(name);
+        attr->setVertexBaseType(Qt3DCore::QAttribute::Float);
+        attr->setVertexSize(size);
+        attr->setAttributeType(Qt3DCore::QAttribute::VertexAttribute);
+        attr->setBuffer(buffer);
+        attr->setByteStride(size * sizeof(float));
+        attr->setDivisor(divisor);
+        attr->setCount(count);
+        return attr;
+    }
+
+    Qt3DRender::QMaterial* createMaterial() {
+        auto material = new Qt3DRender::QMaterial(this);
+        auto effect = new Qt3DRender::QEffect(material);
+        effect->addParameter(new Qt3DRender::QParameter("atlas", m_texture));
+
+        // OpenGL 3.3 (рендерер Qt3D на OpenGL)
+        effect->addTechnique(createTechnique(effect, Qt3DRender::QGraphicsApiFilter::OpenGL, 3, 3,
+                                             kVertexShaderGL, kFragmentShaderGL));
+        // RHI (рендерер Qt3D по умолчанию в Qt 6)
+        effect->addTechnique(createTechnique(effect, Qt3DRender::QGraphicsApiFilter::RHI, 1, 0,
+                                             kVertexShaderRHI, kFragmentShaderRHI));
+
+        material->setEffect(effect);
+        return material;
+    }
+
+    static Qt3DRender::QTechnique* createTechnique(Qt3DCore::QNode* parent, Qt3DRender::QGraphicsApiFilter::Api api,
+                                                   int major, int minor, const char* vertex, const char* fragment) {
+        auto technique = new Qt3DRender::QTechnique(parent);
+        technique->graphicsApiFilter()->setApi(api);
+        technique->graphicsApiFilter()->setMajorVersion(major);
+        technique->graphicsApiFilter()->setMinorVersion(minor);
+        technique->graphicsApiFilter()->setProfile(Qt3DRender::QGraphicsApiFilter::NoProfile);
+
+        // Ключ, по которому QForwardRenderer выбирает технику
+        auto filterKey = new Qt3DRender::QFilterKey(technique);
+        filterKey->setName("renderingStyle");
+        filterKey->setValue("forward");
+        technique->addFilterKey(filterKey);
+
+        auto shader = new Qt3DRender::QShaderProgram(technique);
+        shader->setVertexShaderCode(QByteArray(vertex));
+        shader->setFragmentShaderCode(QByteArray(fragment));
+
+        auto pass = new Qt3DRender::QRenderPass(technique);
+        pass->setShaderProgram(shader);
+
+        // Прозрачный фон текста, подписи не пишут глубину и видны с обеих сторон
+        auto blend = new Qt3DRender::QBlendEquationArguments(pass);
+        blend->setSourceRgba(Qt3DRender::QBlendEquationArguments::One);
+        blend->setDestinationRgba(Qt3DRender::QBlendEquationArguments::OneMinusSourceAlpha);
+        auto blendEquation = new Qt3DRender::QBlendEquation(pass);
+        blendEquation->setBlendFunction(Qt3DRender::QBlendEquation::Add);
+        auto cull = new Qt3DRender::QCullFace(pass);
+        cull->setMode(Qt3DRender::QCullFace::NoCulling);
+        pass->addRenderState(blend);
+        pass->addRenderState(blendEquation);
+        pass->addRenderState(new Qt3DRender::QNoDepthMask(pass));
+        pass->addRenderState(cull);
+
+        technique->addRenderPass(pass);
+        return technique;
+    }
+
+    // --- ШЕЙДЕРЫ ---
+    // Оси "вправо" и "вверх" камеры — строки view-матрицы.
+    // Атлас премультиплицирован (QImage ARGB32_Premultiplied).
+    static constexpr const char* kVertexShaderGL = R"(
+#version 330 core
+in vec2 vertexCorner;
+in vec3 labelAnchor;
+in vec4 labelUvRect;
+in vec4 labelRect;
+out vec2 uv;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+void main() {
+    vec3 right = vec3(viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0]);
+    vec3 up    = vec3(viewMatrix[0][1], viewMatrix[1][1], viewMatrix[2][1]);
+    vec2 local = labelRect.xy + vertexCorner * labelRect.zw;
+    vec3 world = labelAnchor + right * local.x + up * local.y;
+    uv = mix(labelUvRect.xy, labelUvRect.zw, vertexCorner);
+    gl_Position = projectionMatrix * viewMatrix * vec4(world, 1.0);
+}
+)";
+
+    static constexpr const char* kFragmentShaderGL = R"(
+#version 330 core
+in vec2 uv;
+out vec4 fragColor;
+uniform sampler2D atlas;
+void main() {
+    vec4 c = texture(atlas, uv);
+    if (c.a < 0.02) discard;
+    fragColor = c;
+}
+)";
+
+    static constexpr const char* kVertexShaderRHI = R"(
+#version 450 core
+layout(location = 0) in vec2 vertexCorner;
+layout(location = 1) in vec3 labelAnchor;
+layout(location = 2) in vec4 labelUvRect;
+layout(location = 3) in vec4 labelRect;
+layout(location = 0) out vec2 uv;
+layout(std140, binding = 0) uniform qt3d_render_view_uniforms {
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 uncorrectedProjectionMatrix;
+    mat4 clipCorrectionMatrix;
+    mat4 viewProjectionMatrix;
+    mat4 inverseViewMatrix;
+    mat4 inverseProjectionMatrix;
+    mat4 inverseViewProjectionMatrix;
+    mat4 viewportMatrix;
+    mat4 inverseViewportMatrix;
+    vec4 textureTransformMatrix;
+    vec3 eyePosition;
+    float aspectRatio;
+    float gamma;
+    float exposure;
+    float time;
+    float yUpInNDC;
+    float yUpInFBO;
+};
+void main() {
+    vec3 right = vec3(viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0]);
+    vec3 up    = vec3(viewMatrix[0][1], viewMatrix[1][1], viewMatrix[2][1]);
+    vec2 local = labelRect.xy + vertexCorner * labelRect.zw;
+    vec3 world = labelAnchor + right * local.x + up * local.y;
+    uv = mix(labelUvRect.xy, labelUvRect.zw, vertexCorner);
+    gl_Position = viewProjectionMatrix * vec4(world, 1.0);
+}
+)";
+
+    static constexpr const char* kFragmentShaderRHI = R"(
+#version 450 core
+layout(location = 0) in vec2 uv;
+layout(location = 0) out vec4 fragColor;
+layout(binding = 3) uniform sampler2D atlas;
+void main() {
+    vec4 c = texture(atlas, uv);
+    if (c.a < 0.02) discard;
+    fragColor = c;
+}
+)";
+};
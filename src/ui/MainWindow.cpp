@@ -1,11 +1,17 @@
 #include "MainWindow.h"
+#include "PorkchopDialog.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFileDialog>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QQuaternion> 
+#include <QMouseEvent>
+#include <QStatusBar>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <climits>
+#include <QtMath>
 
 #include <Qt3DExtras/QForwardRenderer>
 #include <Qt3DRender/QCamera>
@@ -22,6 +28,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
     rootEntity = new Qt3DCore::QEntity();
     view3D->setRootEntity(rootEntity);
+    view3D->installEventFilter(this);
 
     // 2. Info Panel
     infoDock = new QDockWidget("Object Inspector", this);
@@ -32,6 +39,41 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     infoDock->setWidget(infoText);
     addDockWidget(Qt::RightDockWidgetArea, infoDock);
 
+    // 2b. Events: апсиды, соединения, тесные сближения
+    eventsDock = new QDockWidget("Events", this);
+    eventsDock->setAllowedAreas(Qt::RightDockWidgetArea | Qt::LeftDockWidgetArea | Qt::BottomDockWidgetArea);
+    auto eventsPanel = new QWidget(eventsDock);
+    auto eventsLayout = new QVBoxLayout(eventsPanel);
+
+    checkApsides = new QCheckBox("Perihelion / aphelion", eventsPanel);
+    checkApsides->setChecked(true);
+    connect(checkApsides, &QCheckBox::toggled, this, &MainWindow::rebuildEventWatches);
+    eventsLayout->addWidget(checkApsides);
+
+    checkConjunctions = new QCheckBox("Conjunctions seen from Earth (< 1°)", eventsPanel);
+    connect(checkConjunctions, &QCheckBox::toggled, this, &MainWindow::rebuildEventWatches);
+    eventsLayout->addWidget(checkConjunctions);
+
+    auto approachLayout = new QHBoxLayout();
+    approachLayout->addWidget(new QLabel("Close approach <", eventsPanel));
+    spinApproach = new QDoubleSpinBox(eventsPanel);
+    spinApproach->setRange(0.0, 10.0); spinApproach->setDecimals(3); spinApproach->setSingleStep(0.01);
+    spinApproach->setSuffix(" AU"); spinApproach->setSpecialValueText("off");
+    connect(spinApproach, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &MainWindow::rebuildEventWatches);
+    approachLayout->addWidget(spinApproach);
+    eventsLayout->addLayout(approachLayout);
+
+    btnEventLog = new QPushButton("Log to file", eventsPanel);
+    btnEventLog->setCheckable(true);
+    connect(btnEventLog, &QPushButton::toggled, this, &MainWindow::onEventLogToggled);
+    eventsLayout->addWidget(btnEventLog);
+
+    eventsList = new QListWidget(eventsPanel);
+    eventsList->setStyleSheet("background-color: #2b2b2b; color: #f0f0f0; font-family: Consolas; font-size: 11px;");
+    eventsLayout->addWidget(eventsList, 1);
+    eventsDock->setWidget(eventsPanel);
+    addDockWidget(Qt::RightDockWidgetArea, eventsDock);
+
     // 3. UI
     auto centralWidget = new QWidget(this);
     auto mainLayout = new QVBoxLayout(centralWidget);
@@ -55,6 +97,19 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     connect(btnLoad, &QPushButton::clicked, this, &MainWindow::loadSimulation);
     controlsLayout->addWidget(btnLoad);
 
+    btnGenerate = new QPushButton("Generate", this);
+    connect(btnGenerate, &QPushButton::clicked, this, &MainWindow::onGenerate);
+    controlsLayout->addWidget(btnGenerate);
+
+    btnPorkchop = new QPushButton("Porkchop", this);
+    connect(btnPorkchop, &QPushButton::clicked, this, &MainWindow::onPorkchop);
+    controlsLayout->addWidget(btnPorkchop);
+
+    btnRecord = new QPushButton("Record", this);
+    btnRecord->setCheckable(true);
+    connect(btnRecord, &QPushButton::toggled, this, &MainWindow::onRecordToggled);
+    controlsLayout->addWidget(btnRecord);
+
     controlsLayout->addSpacing(15);
 
     btnZoomIn = new QPushButton("(+)", this);
@@ -96,6 +151,11 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     checkRelativity = new QCheckBox("Gen. Relativity", this);
     connect(checkRelativity, &QCheckBox::toggled, this, &MainWindow::onRelativityToggled);
     physicsLayout->addWidget(checkRelativity);
+
+    checkSecular = new QCheckBox("Secular (Myr)", this);
+    checkSecular->setToolTip("Orbit-averaged Laplace-Lagrange evolution; uncheck to continue with N-body");
+    connect(checkSecular, &QCheckBox::toggled, this, &MainWindow::onSecularToggled);
+    physicsLayout->addWidget(checkSecular);
     controlsLayout->addLayout(physicsLayout);
 
     controlsLayout->addSpacing(15);
@@ -114,12 +174,15 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     resize(1400, 850);
     setWindowTitle("Solar Simulator v2.9 - Memory Safe");
 
+    scheduler.fixedStep = baseTimeStep;
+
     setupScene();
     setupSystem();
 
     timer = new QTimer(this);
     connect(timer, &QTimer::timeout, this, &MainWindow::updateSimulation);
     timer->start(16); 
+    frameClock.start();
 }
 
 void MainWindow::setupScene() {
@@ -139,74 +202,86 @@ void MainWindow::setupScene() {
     lightEntity->addComponent(pointLight);
 
     orbitGrid = new OrbitGrid(rootEntity, scaleFactor);
+
+    labels = new LabelBillboards(rootEntity);
+    labels->setEnabled(checkShowLabels->isChecked());
+
+    visualBodies.attach(rootEntity, 1024);
 }
 
 void MainWindow::createVisuals() {
+    // Тысячи сгенерированных тел: грубые сферы и без хвостов у мелочи
+    const bool crowded = physics.bodies.size() > 500;
+    visualBodies.resize(physics.bodies.size());
     for (size_t i = 0; i < physics.bodies.size(); ++i) {
         auto& body = physics.bodies[i];
-        VisualBody3D vb;
-        vb.physicsIndex = i;
-        vb.entity = new Qt3DCore::QEntity(rootEntity);
-        vb.entity->setObjectName(QString::number(i));
-
-        auto mesh = new Qt3DExtras::QSphereMesh();
-        double r = 3.0;
-        if (body.name == "Sun") r = 20.0;
-        else if (body.name == "Jupiter") r = 10.0;
-        else if (body.name == "Saturn") r = 9.0;
-        else if (body.name == "Earth") r = 5.0;
-        else if (body.name == "Halley's Comet") r = 2.0;
-        mesh->setRadius(r);
-        mesh->setRings(30); mesh->setSlices(30);
-
-        vb.transform = new Qt3DCore::QTransform();
-        auto mat = new Qt3DExtras::QPhongMaterial();
-        mat->setDiffuse(body.color);
-        if (body.name == "Sun") mat->setAmbient(body.color);
-        else { mat->setAmbient(QColor(60, 60, 60)); mat->setShininess(10.0f); }
-
-        vb.entity->addComponent(mesh);
-        vb.entity->addComponent(vb.transform);
-        vb.entity->addComponent(mat);
-
-        auto picker = new Qt3DRender::QObjectPicker(vb.entity);
-        picker->setHoverEnabled(false);
-        connect(picker, &Qt3DRender::QObjectPicker::clicked, this, &MainWindow::onObjectPicked);
-        vb.entity->addComponent(picker);
-
-        if (body.name != "Sun") {
-            vb.trail = new OrbitTrail(rootEntity, body.color, 2000); 
-            vb.trail->setEnabled(checkShowTrails->isChecked());
-        } else {
-            vb.trail = nullptr;
-        }
-
-        vb.label = new Qt3DExtras::QText2DEntity(rootEntity);
-        vb.label->setText(body.name);
-        vb.label->setHeight(20); 
-        vb.label->setWidth(100); 
-        vb.label->setColor(Qt::white);
-        vb.label->setFont(QFont("Arial", 10, QFont::Bold));
-        vb.label->setEnabled(checkShowLabels->isChecked());
-        
-        vb.labelTransform = new Qt3DCore::QTransform();
-        vb.label->addComponent(vb.labelTransform);
+        BodyLook look;
+        if (body.name == "Sun") look.radius = 20.0f;
+        else if (body.name == "Jupiter") look.radius = 10.0f;
+        else if (body.name == "Saturn") look.radius = 9.0f;
+        else if (body.name == "Earth") look.radius = 5.0f;
+        else if (body.name == "Halley's Comet") look.radius = 2.0f;
+        else if (crowded && body.mass < 1e21) look.radius = 1.0f;
+        // Следы и подписи в толпе — только у первых (поименованных) крупных тел:
+        // атлас подписей вмещает несколько сотен имен, след — 1024 вершины на тело
+        const bool minor = crowded && (i >= (size_t)kEventNamedBodies || body.mass < 1e21);
+        look.detail = crowded ? 8 : 30;
+        look.color = body.color;
+        look.emissive = (body.name == "Sun");
+        look.trail = body.name != "Sun" && !minor;
+
+        visualBodies.bind(i, (int)i, look, checkShowTrails->isChecked());
+    }
 
-        visualBodies.push_back(vb);
+    QStringList names;
+    for (const auto& vb : visualBodies) {
+        const auto& body = physics.bodies[vb.physicsIndex];
+        const bool minor = crowded && (vb.physicsIndex >= kEventNamedBodies || body.mass < 1e21);
+        names << (minor ? QString() : body.name);
     }
+    labels->setLabels(names);
+    labelAnchors.resize(visualBodies.size());
+
+    pickCenters.resize(visualBodies.size());
+    pickRadii.resize(visualBodies.size());
+    for (size_t i = 0; i < visualBodies.size(); ++i) pickRadii[i] = visualBodies[i].displayRadius;
+
+    rebuildEventWatches();
     updateVisuals();
 }
 
-void MainWindow::onObjectPicked(Qt3DRender::QPickEvent* event) {
-    auto entity = qobject_cast<Qt3DCore::QEntity*>(sender()->parent());
-    if (entity) {
-        bool ok;
-        int idx = entity->objectName().toInt(&ok);
-        if (ok) {
-            selectedBodyIndex = idx;
-            updateInfoPanel();
+bool MainWindow::eventFilter(QObject* watched, QEvent* event) {
+    if (watched == view3D) {
+        auto mouse = static_cast<QMouseEvent*>(event);
+        if (event->type() == QEvent::MouseButtonPress && mouse->button() == Qt::LeftButton) {
+            pressPos = mouse->position().toPoint();
+        } else if (event->type() == QEvent::MouseButtonRelease && mouse->button() == Qt::LeftButton) {
+            // Перетаскивание — это вращение камеры, а не клик
+            if ((mouse->position().toPoint() - pressPos).manhattanLength() <= 4) {
+                pickAt(mouse->position().toPoint());
+            }
         }
     }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::pickAt(const QPoint& windowPos) {
+    // Сетка обновляется только при клике: пока тела не ушли дальше запаса
+    // ячеек, это копия центров, а не перестройка
+    pickingGrid.update(pickCenters, pickRadii);
+
+    // Луч из камеры через точку клика (unproject ждет Y снизу вверх)
+    auto camera = view3D->camera();
+    QRect viewport(0, 0, view3D->width(), view3D->height());
+    float winY = (float)(view3D->height() - windowPos.y());
+    QVector3D nearPoint = QVector3D((float)windowPos.x(), winY, 0.0f).unproject(camera->viewMatrix(), camera->projectionMatrix(), viewport);
+    QVector3D farPoint = QVector3D((float)windowPos.x(), winY, 1.0f).unproject(camera->viewMatrix(), camera->projectionMatrix(), viewport);
+
+    int hit = pickingGrid.pick(nearPoint, farPoint - nearPoint);
+    if (hit != -1) {
+        selectedBodyIndex = visualBodies[hit].physicsIndex;
+        updateInfoPanel();
+    }
 }
 
 void MainWindow::updateInfoPanel() {
@@ -225,10 +300,10 @@ void MainWindow::updateInfoPanel() {
 }
 
 void MainWindow::updateVisuals() {
-    trailSkipCounter++;
-    bool updateTrail = (trailSkipCounter >= 3);
-
-    QVector3D cameraPos = view3D->camera()->position();
+    // Допуск следов: trailPixelError пикселей на расстоянии тела от камеры
+    auto camera = view3D->camera();
+    const QVector3D cameraPos = camera->position();
+    const float unitsPerPixelAtOne = 2.0f * std::tan(qDegreesToRadians(camera->fieldOfView()) * 0.5f) / std::max(1, view3D->height());
 
     for (size_t i = 0; i < visualBodies.size(); ++i) {
         auto p = physics.bodies[visualBodies[i].physicsIndex].position;
@@ -240,49 +315,62 @@ void MainWindow::updateVisuals() {
 
         visualBodies[i].transform->setTranslation(pos3D);
 
-        if (visualBodies[i].labelTransform) {
-            visualBodies[i].labelTransform->setTranslation(QVector3D(x + 5, y + 10, z));
-            QVector3D direction = cameraPos - pos3D;
-            visualBodies[i].labelTransform->setRotation(QQuaternion::fromDirection(direction, QVector3D(0, 1, 0)));
-        }
+        labelAnchors[i] = pos3D;
+        pickCenters[i] = pos3D;
 
-        if (updateTrail && visualBodies[i].trail && visualBodies[i].trail->isEnabled()) {
+        // В вековом режиме кадры разделены тысячами орбит — след был бы ломаной
+        if (visualBodies[i].trail && visualBodies[i].trail->isEnabled() && !physics.inSecularMode()) {
+            visualBodies[i].trail->setTolerance(trailPixelError * unitsPerPixelAtOne * (pos3D - cameraPos).length());
             visualBodies[i].trail->update(pos3D);
         }
     }
 
-    if (updateTrail) trailSkipCounter = 0;
+    // Разворот подписей к камере делает шейдер — здесь только одна заливка якорей
+    if (labels->isEnabled()) labels->setAnchors(labelAnchors);
 }
 
 void MainWindow::updateSimulation() {
-    physics.step(baseTimeStep * currentSpeedMultiplier);
+    // Реальное время с прошлого кадра (после паузы/диалога не больше 0.1 с)
+    double elapsed = std::min(frameClock.restart() / 1000.0, 0.1);
+    double requested = elapsed / baseFrameInterval * baseTimeStep * currentSpeedMultiplier;
+
+    // Вековой режим: один шаг замкнутой формулой на кадр, без планировщика
+    if (physics.inSecularMode()) {
+        physics.step(requested * kSecularWarp);
+        if (!physics.inSecularMode()) checkSecular->setChecked(false); // Состав тел изменился
+        recordFrameIfActive();
+        statusBar()->showMessage(QString("Secular: %1 kyr").arg(physics.time() / (365.25 * 86400.0) * 1e-3, 0, 'f', 1), 1000);
+        updateVisuals();
+        if (selectedBodyIndex != -1) updateInfoPanel();
+        return;
+    }
+
+    FrameReport report = scheduler.advance(physics, requested);
+    if (report.substeps > 0) { recordFrameIfActive(); showEvents(); }
+    if ((report.behind || report.dropped > 0.0) && elapsed > 0.0) {
+        double achieved = report.simulated / (baseTimeStep * elapsed / baseFrameInterval);
+        statusBar()->showMessage(QString("Falling behind real time: %1x of %2x (%3 steps/frame)")
+            .arg(achieved, 0, 'f', 1).arg(currentSpeedMultiplier, 0, 'f', 1).arg(report.substeps), 1000);
+    }
+
     updateVisuals();
     if (selectedBodyIndex != -1) updateInfoPanel();
 }
 
-// --- ИСПРАВЛЕННАЯ ФУНКЦИЯ ОЧИСТКИ (MEMORY SAFE) ---
+// --- ОЧИСТКА: тела уходят в пул, сцена не пересобирается ---
 void MainWindow::clearSystem() {
-    for (auto& vb : visualBodies) {
-        // Безопасное удаление через Qt Event Loop
-        if (vb.entity) {
-            vb.entity->setParent((Qt3DCore::QEntity*)nullptr);
-            vb.entity->deleteLater();
-            vb.entity = nullptr;
-        }
-        if (vb.trail) {
-            vb.trail->setParent((Qt3DCore::QEntity*)nullptr);
-            vb.trail->deleteLater();
-            vb.trail = nullptr;
-        }
-        if (vb.label) {
-            vb.label->setParent((Qt3DCore::QEntity*)nullptr);
-            vb.label->deleteLater();
-            vb.label = nullptr;
-        }
-    }
-    
-    visualBodies.clear();
-    physics.bodies.clear();
+    // Запись привязана к набору тел — при смене сценария закрываем файл
+    if (recorder) btnRecord->setChecked(false);
+    checkSecular->setChecked(false);
+
+    // Сущности не удаляются — уходят в пул до следующего createVisuals
+    visualBodies.release();
+    scheduler.reset();
+    labels->setLabels(QStringList());
+    labelAnchors.clear();
+    pickCenters.clear();
+    pickRadii.clear();
+    physics.clear();
     selectedBodyIndex = -1;
     updateInfoPanel();
 }
@@ -300,9 +388,8 @@ void MainWindow::resetCamera() {
 }
 
 void MainWindow::onShowLabelsToggled(bool checked) {
-    for (auto& vb : visualBodies) {
-        if (vb.label) vb.label->setEnabled(checked);
-    }
+    labels->setEnabled(checked);
+    if (checked) labels->setAnchors(labelAnchors);
 }
 
 void MainWindow::onShowTrailsToggled(bool checked) {
@@ -331,7 +418,7 @@ void MainWindow::setupSystem() {
 
 void MainWindow::toggleSimulation() {
     if (timer->isActive()) { timer->stop(); btnPlayPause->setText("Resume"); }
-    else { timer->start(); btnPlayPause->setText("Pause"); }
+    else { timer->start(); frameClock.restart(); btnPlayPause->setText("Pause"); }
 }
 void MainWindow::resetSimulation() { setupSystem(); if (!timer->isActive()) toggleSimulation(); }
 void MainWindow::onSpeedChanged(int val) {
@@ -341,13 +428,32 @@ void MainWindow::onSpeedChanged(int val) {
 void MainWindow::onIntegratorChanged(int index) { physics.currentIntegrator = (index == 0) ? IntegratorType::Verlet : IntegratorType::RungeKutta4; }
 void MainWindow::onRelativityToggled(bool checked) { physics.useRelativity = checked; }
 
+// Вход — снимок элементов с текущего состояния, выход — N-body продолжает
+// с последнего векового состояния; следы обоих режимов не склеиваются
+void MainWindow::onSecularToggled(bool checked) {
+    if (checked && !physics.inSecularMode() && !physics.enterSecular()) {
+        QSignalBlocker block(checkSecular);
+        checkSecular->setChecked(false);
+        statusBar()->showMessage("Secular mode needs bound prograde orbits", 3000);
+        return;
+    }
+    if (!checked) physics.leaveSecular();
+    comboIntegrator->setEnabled(!checked);
+    checkRelativity->setEnabled(!checked);
+    scheduler.reset();
+    for (auto& vb : visualBodies) if (vb.trail) vb.trail->clear();
+}
+
 void MainWindow::saveSimulation() {
     bool wasRunning = timer->isActive(); if (wasRunning) timer->stop(); 
     QString fileName = QFileDialog::getSaveFileName(this, "Save", "", "JSON (*.json)");
     if (!fileName.isEmpty()) {
         QJsonArray arr;
-        for (const auto& b : physics.bodies) {
+        for (size_t i = 0; i < physics.bodies.size(); ++i) {
+            const auto& b = physics.bodies[i];
             QJsonObject o; o["name"] = b.name; o["mass"] = b.mass; o["radius"] = b.radius; o["color"] = b.color.name();
+            int parent = physics.parentOf((int)i);
+            if (parent >= 0) o["parent"] = physics.bodies[parent].name;
             o["posX"] = b.position.x(); o["posY"] = b.position.y(); o["posZ"] = b.position.z();
             o["velX"] = b.velocity.x(); o["velY"] = b.velocity.y(); o["velZ"] = b.velocity.z();
             arr.append(o);
@@ -358,6 +464,197 @@ void MainWindow::saveSimulation() {
     if (wasRunning) timer->start();
 }
 
+void MainWindow::onRecordToggled(bool checked) {
+    if (!checked) {
+        stopRecording();
+        return;
+    }
+
+    bool wasRunning = timer->isActive(); if (wasRunning) timer->stop();
+    QString fileName = QFileDialog::getSaveFileName(this, "Record trajectory", "", "Trajectory (*.strj)");
+    bool ok = false;
+    double maxError = 0.0;
+    if (!fileName.isEmpty()) {
+        maxError = QInputDialog::getDouble(this, "Record trajectory", "Max position error, m:", 1000.0, 1e-3, 1e12, 3, &ok);
+    }
+
+    if (ok) {
+        recordFile = std::make_unique<std::ofstream>(fileName.toStdString(), std::ios::binary);
+        if (*recordFile) {
+            recorder = std::make_unique<TrajectoryEncoder>(*recordFile, (int)physics.bodies.size(), maxError);
+            recordFrameIfActive(); // Начальное состояние
+        } else {
+            recordFile.reset();
+            QMessageBox::warning(this, "Record", "Cannot open " + fileName);
+        }
+    }
+
+    if (!recorder) {
+        QSignalBlocker block(btnRecord);
+        btnRecord->setChecked(false);
+    }
+    if (wasRunning) { timer->start(); frameClock.restart(); }
+}
+
+void MainWindow::recordFrameIfActive() {
+    if (!recorder) return;
+    recordFrame.resize(physics.bodies.size() * 3);
+    for (size_t i = 0; i < physics.bodies.size(); ++i) {
+        const auto& p = physics.bodies[i].position;
+        recordFrame[3 * i] = p.x(); recordFrame[3 * i + 1] = p.y(); recordFrame[3 * i + 2] = p.z();
+    }
+    if (!recorder->addFrame(physics.time(), recordFrame.data())) {
+        statusBar()->showMessage("Record: coordinates out of range for this error bound, stopping", 5000);
+        btnRecord->setChecked(false);
+    }
+}
+
+void MainWindow::stopRecording() {
+    if (!recorder) return;
+    recorder->finish();
+    statusBar()->showMessage(QString("Recorded %1 frames, %2 KB").arg(recorder->frameCount()).arg(recorder->bytesWritten() / 1024), 5000);
+    recorder.reset();
+    recordFile.reset();
+}
+
+void MainWindow::onPorkchop() {
+    bool wasRunning = timer->isActive(); if (wasRunning) timer->stop();
+    PorkchopDialog dialog(physics, this);
+    dialog.resize(560, 760);
+    dialog.exec();
+    if (wasRunning) { timer->start(); frameClock.restart(); }
+}
+
+void MainWindow::onGenerate() {
+    bool wasRunning = timer->isActive(); if (wasRunning) timer->stop();
+
+    const QStringList kinds = {"Asteroid belt", "Kuiper belt", "Protoplanetary disk", "Plummer star cluster"};
+    bool ok = false;
+    QString kind = QInputDialog::getItem(this, "Generate", "Population:", kinds, 0, false, &ok);
+    int count = ok ? QInputDialog::getInt(this, "Generate", QString("Bodies (up to %1):").arg(kMaxGeneratedBodies),
+                                          2000, 1, kMaxGeneratedBodies, 100, &ok) : 0;
+    int seed = ok ? QInputDialog::getInt(this, "Generate", "Seed:", 1, 0, INT_MAX, 1, &ok) : 0;
+
+    if (ok) {
+        PopulationParams prm;
+        QColor color;
+        switch (kinds.indexOf(kind)) {
+        case 0: prm = PopulationParams::asteroidBelt(count, seed); color = QColor("#a0a0a0"); break;
+        case 1: prm = PopulationParams::kuiperBelt(count, seed); color = QColor("#8fb3d9"); break;
+        case 2: prm = PopulationParams::protoplanetaryDisk(count, seed); color = QColor("#d9a05b"); break;
+        default: prm = PopulationParams::plummerCluster(count, seed); color = QColor("#fff4e0"); break;
+        }
+
+        // Пояса и диск добавляются к текущей системе вокруг самого массивного тела,
+        // скопление заменяет ее целиком
+        std::vector<CelestialBody> keep;
+        std::vector<int> keepParents;
+        if (prm.kind != PopulationKind::PlummerCluster) {
+            keep = physics.bodies;
+            for (size_t i = 0; i < keep.size(); ++i) keepParents.push_back(physics.parentOf((int)i));
+            if (keep.empty()) keep.push_back(CelestialBody("Sun", 1.989e30, 696340000, Qt::yellow, {0, 0, 0}, {0, 0, 0}));
+            const CelestialBody* center = &keep[0];
+            for (const auto& b : keep) if (b.mass > center->mass) center = &b;
+            prm.centralMass = center->mass;
+            prm.centerPosition = center->position;
+            prm.centerVelocity = center->velocity;
+        }
+
+        const GeneratedPopulation pop = generatePopulation(prm);
+        clearSystem();
+        for (const auto& b : keep) physics.addBody(b);
+        for (int i = 0; i < (int)keepParents.size(); ++i) {
+            if (keepParents[i] >= 0) physics.setParent(i, keepParents[i]);
+        }
+        const QString prefix = populationName(prm.kind);
+        for (int i = 0; i < pop.size(); ++i) {
+            physics.addBody(CelestialBody(prefix + " " + QString::number(i + 1), pop.masses[i], pop.radii[i], color,
+                                          pop.positions[i], pop.velocities[i]));
+        }
+        createVisuals();
+        statusBar()->showMessage(QString("Generated %1 bodies").arg(pop.size()), 5000);
+    }
+    if (wasRunning) { timer->start(); frameClock.restart(); }
+}
+
+void MainWindow::rebuildEventWatches() {
+    auto& events = physics.events;
+    events.clear();
+    const int n = (int)physics.bodies.size();
+    if (n == 0) return;
+
+    // Центр апсид — самое массивное тело, для спутников — их планета
+    int center = 0;
+    for (int i = 1; i < n; ++i) if (physics.bodies[i].mass > physics.bodies[center].mass) center = i;
+
+    // Поименованные тела: у сгенерированных популяций апсид и соединений слишком много
+    const int named = std::min(n, kEventNamedBodies);
+    if (checkApsides->isChecked()) {
+        for (int i = 0; i < named; ++i) {
+            int parent = physics.parentOf(i);
+            if (i != center) events.watchApsides(i, parent >= 0 ? parent : center);
+        }
+    }
+
+    if (checkConjunctions->isChecked()) {
+        int earth = -1;
+        for (int i = 0; i < n; ++i) if (physics.bodies[i].name == "Earth") { earth = i; break; }
+        if (earth >= 0) {
+            for (int a = 0; a < named; ++a)
+                for (int b = a + 1; b < named; ++b)
+                    if (a != earth && b != earth && physics.parentOf(a) != earth && physics.parentOf(b) != earth)
+                        events.watchSeparation(earth, a, b, qDegreesToRadians(1.0));
+        }
+    }
+
+    events.setCloseApproachDistance(spinApproach->value() * 1.496e11);
+    events.log = eventLogFile ? eventLogFile.get() : nullptr;
+}
+
+void MainWindow::showEvents() {
+    const std::vector<SimEvent> found = physics.events.takeEvents();
+    if (found.empty()) return;
+
+    for (const auto& ev : found) {
+        QString text = QString("day %1  %2  %3").arg(ev.time / 86400.0, 0, 'f', 3)
+            .arg(eventKindName(ev.kind), physics.bodies[ev.body].name);
+        if (ev.observer != -1) {
+            text += QString(" – %1 (from %2)").arg(physics.bodies[ev.other].name, physics.bodies[ev.observer].name);
+        } else {
+            text += QString(" – %1: %2 AU").arg(physics.bodies[ev.other].name).arg(ev.value / 1.496e11, 0, 'f', 5);
+        }
+        eventsList->addItem(text);
+    }
+
+    // Список ограничен — в файл пишется все
+    while (eventsList->count() > kMaxEventRows) delete eventsList->takeItem(0);
+    eventsList->scrollToBottom();
+}
+
+void MainWindow::onEventLogToggled(bool checked) {
+    if (!checked) {
+        physics.events.log = nullptr;
+        eventLogFile.reset();
+        return;
+    }
+
+    bool wasRunning = timer->isActive(); if (wasRunning) timer->stop();
+    QString fileName = QFileDialog::getSaveFileName(this, "Event log", "", "Text (*.log *.txt)");
+    if (!fileName.isEmpty()) {
+        eventLogFile = std::make_unique<std::ofstream>(fileName.toStdString());
+        if (!*eventLogFile) {
+            eventLogFile.reset();
+            QMessageBox::warning(this, "Event log", "Cannot open " + fileName);
+        }
+    }
+    physics.events.log = eventLogFile ? eventLogFile.get() : nullptr;
+    if (!eventLogFile) {
+        QSignalBlocker block(btnEventLog);
+        btnEventLog->setChecked(false);
+    }
+    if (wasRunning) { timer->start(); frameClock.restart(); }
+}
+
 void MainWindow::loadSimulation() {
     bool wasRunning = timer->isActive(); if (wasRunning) timer->stop();
     QString fileName = QFileDialog::getOpenFileName(this, "Load", "", "JSON (*.json)");
@@ -373,6 +670,14 @@ void MainWindow::loadSimulation() {
                 Eigen::Vector3d v3(o["velX"].toDouble(), o["velY"].toDouble(), o["velZ"].toDouble());
                 physics.addBody(CelestialBody(o["name"].toString(), o["mass"].toDouble(), o["radius"].toDouble(), QColor(o["color"].toString()), p, v3));
             }
+            // Спутники — в подсистемы своих планет
+            for (int i = 0; i < arr.size(); ++i) {
+                QString parentName = arr[i].toObject()["parent"].toString();
+                if (parentName.isEmpty()) continue;
+                for (int j = 0; j < (int)physics.bodies.size(); ++j) {
+                    if (j != i && physics.bodies[j].name == parentName) { physics.setParent(i, j); break; }
+                }
+            }
             createVisuals(); 
         }
     }
@@ -8,6 +8,9 @@
 #include <QCheckBox>
 #include <QDockWidget>
 #include <QTextEdit>
+#include <QElapsedTimer>
+#include <QListWidget>
+#include <QDoubleSpinBox>
 
 // Qt 3D
 #include <Qt3DExtras/Qt3DWindow>
@@ -17,24 +20,18 @@
 #include <Qt3DExtras/QSphereMesh>
 #include <Qt3DExtras/QPhongMaterial>
 #include <Qt3DRender/QPointLight>
-#include <Qt3DRender/QObjectPicker> 
-#include <Qt3DRender/QPickEvent>
-#include <Qt3DExtras/QText2DEntity>
 
 #include "../core/PhysicsEngine.h"
+#include "../core/FrameScheduler.h"
+#include "../core/TrajectoryCodec.h"
+#include "../core/ScenarioGenerator.h"
+#include <fstream>
+#include <memory>
 #include "OrbitTrail.h"
 #include "OrbitGrid.h" 
-
-struct VisualBody3D {
-    Qt3DCore::QEntity* entity;
-    Qt3DCore::QTransform* transform;
-    int physicsIndex;
-    OrbitTrail* trail;
-    
-    // Подпись
-    Qt3DExtras::QText2DEntity* label;
-    Qt3DCore::QTransform* labelTransform;
-};
+#include "LabelBillboards.h"
+#include "PickingGrid.h"
+#include "VisualBodyPool.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -42,6 +39,10 @@ class MainWindow : public QMainWindow {
 public:
     MainWindow(QWidget *parent = nullptr);
 
+protected:
+    // Клики по 3D-окну: выбор тела лучом из камеры
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private slots:
     void updateSimulation();
     void toggleSimulation();
@@ -49,8 +50,14 @@ private slots:
     void onSpeedChanged(int val);
     void saveSimulation();
     void loadSimulation();
+    void onGenerate();
+    void onPorkchop();
+    void onRecordToggled(bool checked);
     void onIntegratorChanged(int index);
     void onRelativityToggled(bool checked);
+    void onSecularToggled(bool checked);
+    void rebuildEventWatches();
+    void onEventLogToggled(bool checked);
 
     // Управление видом
     void zoomIn();
@@ -61,28 +68,42 @@ private slots:
     void onShowLabelsToggled(bool checked);
     void onShowTrailsToggled(bool checked);
 
-    void onObjectPicked(Qt3DRender::QPickEvent* event);
-
 private:
     PhysicsEngine physics;
     QTimer* timer;
 
+    // Шаг физики фиксирован, скорость = число шагов за кадр
+    FrameScheduler scheduler;
+    QElapsedTimer frameClock;
+
     Qt3DExtras::Qt3DWindow* view3D;
     Qt3DCore::QEntity* rootEntity;
     Qt3DExtras::QOrbitCameraController* cameraController;
     
     OrbitGrid* orbitGrid;
 
-    std::vector<VisualBody3D> visualBodies;
+    // Все подписи — один инстансный billboard
+    LabelBillboards* labels;
+    std::vector<QVector3D> labelAnchors;
+
+    // Сущности тел переиспользуются между сценариями
+    VisualBodyPool visualBodies;
     int selectedBodyIndex = -1;
 
+    // Выбор тел на CPU по последним отрисованным позициям
+    PickingGrid pickingGrid;
+    std::vector<QVector3D> pickCenters;
+    std::vector<float> pickRadii;
+    QPoint pressPos;
+
     // UI Elements
-    QPushButton *btnPlayPause, *btnReset, *btnSave, *btnLoad;
+    QPushButton *btnPlayPause, *btnReset, *btnSave, *btnLoad, *btnGenerate, *btnPorkchop, *btnRecord;
     QPushButton *btnZoomIn, *btnZoomOut, *btnResetView;
     QSlider* sliderSpeed;
     QLabel* labelSpeed;
     QComboBox* comboIntegrator;
     QCheckBox* checkRelativity;
+    QCheckBox* checkSecular;
     
     // Новые чекбоксы
     QCheckBox* checkShowLabels;
@@ -91,11 +112,30 @@ private:
     QDockWidget* infoDock;
     QTextEdit* infoText;
 
+    // События между шагами
+    static constexpr int kEventNamedBodies = 64; // Апсиды и соединения — только для первых тел
+    // Каждое тело сцены — сущность со своей трансформацией; больше — через scengen и C API
+    static constexpr int kMaxGeneratedBodies = 5000;
+    static constexpr int kMaxEventRows = 1000;
+    QDockWidget* eventsDock;
+    QListWidget* eventsList;
+    QCheckBox *checkApsides, *checkConjunctions;
+    QDoubleSpinBox* spinApproach;
+    QPushButton* btnEventLog;
+    std::unique_ptr<std::ofstream> eventLogFile;
+
     double scaleFactor = 100.0 / 1.496e11;
     double baseTimeStep = 3600 * 24;
+    double baseFrameInterval = 0.016; // 1.0x = baseTimeStep модельного времени за кадр
     double currentSpeedMultiplier = 1.0;
+    static constexpr double kSecularWarp = 36525.0; // В вековом режиме сутки кадра — 100 лет
     
-    int trailSkipCounter = 0;
+    float trailPixelError = 0.75f; // Допустимое отклонение следа от пути, пиксели
+
+    // Запись траектории (.strj), кадр на каждый кадр отрисовки
+    std::unique_ptr<std::ofstream> recordFile;
+    std::unique_ptr<TrajectoryEncoder> recorder;
+    std::vector<double> recordFrame;
 
     void setupScene();
     void setupSystem();
@@ -103,4 +143,8 @@ private:
     void createVisuals();
     void updateVisuals();
     void updateInfoPanel();
+    void recordFrameIfActive();
+    void stopRecording();
+    void showEvents();
+    void pickAt(const QPoint& windowPos);
 };
\ No newline at end of file
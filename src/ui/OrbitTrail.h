@@ -9,65 +9,92 @@
 #include <QVector3D>
 #include <QByteArray>
 
+#include "TrailHistory.h"
+
+// След орбиты: адаптивно прореженная история (TrailHistory) в одной полосе линий.
+// Буфер на GPU выделен под весь бюджет вершин сразу, поэтому обычный кадр
+// дописывает только текущее положение (12 байт), новая вершина — еще 12 байт,
+// и лишь перестройка уровней перезаливает полосу целиком.
 class OrbitTrail : public Qt3DCore::QEntity {
 public:
-    OrbitTrail(Qt3DCore::QEntity* parent, QColor color, int maxPoints = 5000)
-        : Qt3DCore::QEntity(parent), m_maxPoints(maxPoints) {
-        
-        // 1.  ()
+    OrbitTrail(Qt3DCore::QEntity* parent, QColor color, int vertexBudget = 1024)
+        : Qt3DCore::QEntity(parent), m_history(vertexBudget) {
+
+        // 1. Рендерер (Рисовальщик)
         m_renderer = new Qt3DRender::QGeometryRenderer(this);
-        m_renderer->setPrimitiveType(Qt3DRender::QGeometryRenderer::LineStrip); //  --
+        m_renderer->setPrimitiveType(Qt3DRender::QGeometryRenderer::LineStrip); // Линия точка-за-точкой
 
-        // 2.  ()
+        // 2. Геометрия: буфер сразу на максимум вершин
         m_geometry = new Qt3DCore::QGeometry(this);
         m_buffer = new Qt3DCore::QBuffer(m_geometry);
-        
-        //   (x, y, z)
+        m_buffer->setData(QByteArray(m_history.maxVertices() * kStride, '\0'));
+
+        // Атрибут позиции (x, y, z)
         m_posAttribute = new Qt3DCore::QAttribute(m_geometry);
         m_posAttribute->setName(Qt3DCore::QAttribute::defaultPositionAttributeName());
         m_posAttribute->setVertexBaseType(Qt3DCore::QAttribute::Float);
-        m_posAttribute->setVertexSize(3); // x, y, z
+        m_posAttribute->setVertexSize(3);
         m_posAttribute->setAttributeType(Qt3DCore::QAttribute::VertexAttribute);
+        m_posAttribute->setByteStride(kStride);
         m_posAttribute->setBuffer(m_buffer);
-        
-        // 
+
         m_geometry->addAttribute(m_posAttribute);
         m_renderer->setGeometry(m_geometry);
+        m_renderer->setVertexCount(0);
 
-        // 3.  ()
+        // 3. Материал (цвет)
         m_material = new Qt3DExtras::QPhongMaterial(this);
-        m_material->setAmbient(color); //  
+        m_material->setAmbient(color);
         m_material->setDiffuse(color);
-        m_material->setShininess(0);   //   
+        m_material->setShininess(0);
 
-        //  
         addComponent(m_renderer);
         addComponent(m_material);
     }
 
-    //     
+    // Допуск прореживания в единицах сцены (из ошибки в пикселях на расстоянии тела)
+    void setTolerance(float sceneUnits) { m_history.setTolerance(sceneUnits); }
+
+    // Новое положение тела — каждый кадр
     void update(QVector3D newPos) {
-        //    
-        m_points.push_back(newPos);
-        
-        //    ,   (    )
-        if (m_points.size() > m_maxPoints) {
-            m_points.erase(m_points.begin()); //   
+        const int before = m_history.committedCount();
+        switch (m_history.push(newPos)) {
+        case TrailHistory::Change::HeadOnly:
+            writeVertex(before, newPos);
+            break;
+        case TrailHistory::Change::Appended: {
+            const int after = m_history.committedCount();
+            QByteArray bytes((after - before + 1) * kStride, Qt::Uninitialized);
+            float* raw = reinterpret_cast<float*>(bytes.data());
+            for (int i = before; i < after; ++i) raw = put(raw, m_history.committed(i));
+            put(raw, newPos);
+            m_buffer->updateData(before * kStride, bytes);
+            break;
+        }
+        case TrailHistory::Change::Rebuilt:
+            uploadAll();
+            break;
         }
+        m_renderer->setVertexCount(m_history.committedCount() + 1);
+    }
 
-        //   GPU (   ,    )
-        updateBuffer();
+    // Перекраска при повторном использовании следа другим телом
+    void setColor(const QColor& color) {
+        m_material->setAmbient(color);
+        m_material->setDiffuse(color);
     }
 
-    //   ( )
+    // Очистка следа (при сбросе)
     void clear() {
-        m_points.clear();
-        updateBuffer();
+        m_history.clear();
+        m_renderer->setVertexCount(0);
     }
 
 private:
-    int m_maxPoints;
-    std::vector<QVector3D> m_points;
+    static constexpr int kStride = 3 * sizeof(float);
+
+    TrailHistory m_history;
+    std::vector<QVector3D> m_scratch;
 
     Qt3DRender::QGeometryRenderer* m_renderer;
     Qt3DCore::QGeometry* m_geometry;
@@ -75,25 +102,25 @@ private:
     Qt3DCore::QAttribute* m_posAttribute;
     Qt3DExtras::QPhongMaterial* m_material;
 
-    void updateBuffer() {
-        //  vector<QVector3D>    (float array)
-        QByteArray data;
-        data.resize(m_points.size() * 3 * sizeof(float));
-        
-        float* rawData = reinterpret_cast<float*>(data.data());
-        for (const auto& p : m_points) {
-            *rawData++ = p.x();
-            *rawData++ = p.y();
-            *rawData++ = p.z();
-        }
+    static float* put(float* raw, const QVector3D& p) {
+        *raw++ = p.x();
+        *raw++ = p.y();
+        *raw++ = p.z();
+        return raw;
+    }
+
+    void writeVertex(int index, const QVector3D& p) {
+        QByteArray bytes(kStride, Qt::Uninitialized);
+        put(reinterpret_cast<float*>(bytes.data()), p);
+        m_buffer->updateData(index * kStride, bytes);
+    }
 
-        //   
-        m_buffer->setData(data);
-        
-        //  ,   
-        m_renderer->setVertexCount(m_points.size());
-        
-        //      (3 float * 4 byte = 12)
-        m_posAttribute->setByteStride(3 * sizeof(float)); 
+    void uploadAll() {
+        m_history.collect(m_scratch);
+        m_scratch.push_back(m_history.head());
+        QByteArray bytes((int)m_scratch.size() * kStride, Qt::Uninitialized);
+        float* raw = reinterpret_cast<float*>(bytes.data());
+        for (const auto& p : m_scratch) raw = put(raw, p);
+        m_buffer->updateData(0, bytes);
     }
-};
\ No newline at end of file
+};
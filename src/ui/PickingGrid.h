@@ -0,0 +1,202 @@
+#pragma once
+
+#include <QVector3D>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+// Выбор тел лучом без обхода графа сцены Qt3D.
+// Равномерная сетка над отрисованными позициями и радиусами (координаты сцены):
+// построение — сортировка подсчетом за O(N), запрос — 3D DDA по ячейкам
+// вдоль луча с ранним выходом, как только ячейка дальше лучшего попадания.
+// Сетка "рыхлая": тело занимает ячейки своей сферы, расширенной на запас в
+// четверть ячейки, поэтому пока тела сдвинулись меньше запаса, update только
+// подменяет центры (O(N) копия) вместо перестройки.
+// Не зависит от способа отрисовки: сферы, инстансы, точки-спрайты.
+class PickingGrid {
+public:
+    // Свежие центры и радиусы перед запросом; перестраивает сетку, только если
+    // изменился состав тел или радиусы, или какое-то тело ушло дальше запаса.
+    // Возвращает true, если сетка перестроена.
+    bool update(const std::vector<QVector3D>& centers, const std::vector<float>& radii) {
+        if (centers.size() != m_built.size() || radii != m_radii) {
+            rebuild(centers, radii);
+            return true;
+        }
+        const float slack2 = m_slack * m_slack;
+        for (size_t i = 0; i < centers.size(); ++i) {
+            if ((centers[i] - m_built[i]).lengthSquared() > slack2) {
+                rebuild(centers, radii);
+                return true;
+            }
+        }
+        m_centers = centers;
+        return false;
+    }
+
+    void rebuild(const std::vector<QVector3D>& centers, const std::vector<float>& radii) {
+        m_centers = centers;
+        m_built = centers;
+        m_radii = radii;
+        const int n = (int)m_centers.size();
+        m_cellStart.clear();
+        m_items.clear();
+        m_slack = 0.0f;
+        if (n == 0) return;
+
+        // 1. Границы всех сфер
+        QVector3D lo = m_centers[0], hi = m_centers[0];
+        for (int i = 0; i < n; ++i) {
+            QVector3D r(m_radii[i], m_radii[i], m_radii[i]);
+            lo = minVec(lo, m_centers[i] - r);
+            hi = maxVec(hi, m_centers[i] + r);
+        }
+        QVector3D extent = hi - lo;
+
+        // 2. Размер ячейки: в среднем ~1 тело на ячейку, но не больше kMaxCells
+        double volume = std::max(1e-6, (double)extent.x()) * std::max(1e-6, (double)extent.y()) * std::max(1e-6, (double)extent.z());
+        double cellCount = std::min((double)kMaxCells, (double)n);
+        m_cell = (float)std::cbrt(volume / cellCount);
+        float maxExtent = std::max({extent.x(), extent.y(), extent.z()});
+        m_cell = std::max(m_cell, maxExtent / kMaxCellsPerAxis);
+        if (m_cell <= 0.0f) m_cell = 1.0f;
+
+        // Запас на движение тел между перестройками
+        m_slack = 0.25f * m_cell;
+        const QVector3D slack(m_slack, m_slack, m_slack);
+        lo -= slack;
+        extent += 2.0f * slack;
+
+        m_min = lo;
+        m_dims[0] = std::max(1, (int)std::ceil(extent.x() / m_cell));
+        m_dims[1] = std::max(1, (int)std::ceil(extent.y() / m_cell));
+        m_dims[2] = std::max(1, (int)std::ceil(extent.z() / m_cell));
+        const int cells = m_dims[0] * m_dims[1] * m_dims[2];
+
+        // 3. Сортировка подсчетом: тело попадает во все ячейки своего AABB
+        m_cellStart.assign(cells + 1, 0);
+        forEachCell(n, [&](int cell, int) { m_cellStart[cell + 1]++; });
+        for (int c = 0; c < cells; ++c) m_cellStart[c + 1] += m_cellStart[c];
+
+        m_items.resize(m_cellStart[cells]);
+        std::vector<int> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+        forEachCell(n, [&](int cell, int body) { m_items[cursor[cell]++] = body; });
+    }
+
+    // Ближайшее тело на луче или -1. direction не обязан быть нормирован.
+    int pick(const QVector3D& origin, QVector3D direction) const {
+        if (m_items.empty() || direction.isNull()) return -1;
+        direction.normalize();
+
+        // 1. Вход и выход луча из границ сетки
+        float tEnter = 0.0f, tExit = std::numeric_limits<float>::max();
+        for (int a = 0; a < 3; ++a) {
+            float lo = m_min[a], hi = m_min[a] + m_dims[a] * m_cell;
+            if (std::fabs(direction[a]) < 1e-12f) {
+                if (origin[a] < lo || origin[a] > hi) return -1;
+                continue;
+            }
+            float t0 = (lo - origin[a]) / direction[a];
+            float t1 = (hi - origin[a]) / direction[a];
+            if (t0 > t1) std::swap(t0, t1);
+            tEnter = std::max(tEnter, t0);
+            tExit = std::min(tExit, t1);
+        }
+        if (tEnter > tExit) return -1;
+
+        // 2. DDA (Amanatides & Woo)
+        QVector3D p = origin + direction * tEnter;
+        int cell[3], step[3];
+        float tMax[3], tDelta[3];
+        for (int a = 0; a < 3; ++a) {
+            cell[a] = std::clamp((int)((p[a] - m_min[a]) / m_cell), 0, m_dims[a] - 1);
+            if (direction[a] > 0) {
+                step[a] = 1;
+                tMax[a] = tEnter + ((m_min[a] + (cell[a] + 1) * m_cell) - p[a]) / direction[a];
+                tDelta[a] = m_cell / direction[a];
+            } else if (direction[a] < 0) {
+                step[a] = -1;
+                tMax[a] = tEnter + ((m_min[a] + cell[a] * m_cell) - p[a]) / direction[a];
+                tDelta[a] = -m_cell / direction[a];
+            } else {
+                step[a] = 0;
+                tMax[a] = tDelta[a] = std::numeric_limits<float>::max();
+            }
+        }
+
+        int best = -1;
+        float bestT = std::numeric_limits<float>::max();
+        float tCell = tEnter;
+
+        while (tCell <= bestT) {
+            const int c = (cell[2] * m_dims[1] + cell[1]) * m_dims[0] + cell[0];
+            for (int k = m_cellStart[c]; k < m_cellStart[c + 1]; ++k) {
+                const int body = m_items[k];
+                float t;
+                if (intersect(origin, direction, body, t) && t < bestT) {
+                    bestT = t;
+                    best = body;
+                }
+            }
+
+            // Следующая ячейка по наименьшему tMax
+            int a = (tMax[0] < tMax[1]) ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+            tCell = tMax[a];
+            cell[a] += step[a];
+            if (cell[a] < 0 || cell[a] >= m_dims[a] || tCell > tExit) break;
+            tMax[a] += tDelta[a];
+        }
+        return best;
+    }
+
+private:
+    static constexpr int kMaxCells = 1 << 21;       // ~2 млн ячеек, 8 МБ индексов
+    static constexpr float kMaxCellsPerAxis = 1024.0f;
+
+    std::vector<QVector3D> m_centers; // Для пересечений — последние из update
+    std::vector<QVector3D> m_built;   // По ним разложены ячейки
+    std::vector<float> m_radii;
+    float m_slack = 0.0f;
+
+    QVector3D m_min;
+    float m_cell = 1.0f;
+    int m_dims[3] = {0, 0, 0};
+    std::vector<int> m_cellStart; // Начало списка тел ячейки (CSR)
+    std::vector<int> m_items;
+
+    static QVector3D minVec(const QVector3D& a, const QVector3D& b) {
+        return QVector3D(std::min(a.x(), b.x()), std::min(a.y(), b.y()), std::min(a.z(), b.z()));
+    }
+    static QVector3D maxVec(const QVector3D& a, const QVector3D& b) {
+        return QVector3D(std::max(a.x(), b.x()), std::max(a.y(), b.y()), std::max(a.z(), b.z()));
+    }
+
+    template <typename F>
+    void forEachCell(int n, F&& f) const {
+        for (int i = 0; i < n; ++i) {
+            int lo[3], hi[3];
+            for (int a = 0; a < 3; ++a) {
+                const float r = m_radii[i] + m_slack;
+                lo[a] = std::clamp((int)((m_built[i][a] - r - m_min[a]) / m_cell), 0, m_dims[a] - 1);
+                hi[a] = std::clamp((int)((m_built[i][a] + r - m_min[a]) / m_cell), 0, m_dims[a] - 1);
+            }
+            for (int z = lo[2]; z <= hi[2]; ++z)
+                for (int y = lo[1]; y <= hi[1]; ++y)
+                    for (int x = lo[0]; x <= hi[0]; ++x)
+                        f((z * m_dims[1] + y) * m_dims[0] + x, i);
+        }
+    }
+
+    // Луч-сфера: ближайшее t >= 0 (0, если начало луча внутри сферы)
+    bool intersect(const QVector3D& origin, const QVector3D& dir, int body, float& t) const {
+        QVector3D oc = origin - m_centers[body];
+        float b = QVector3D::dotProduct(oc, dir);
+        float c = oc.lengthSquared() - m_radii[body] * m_radii[body];
+        if (c <= 0.0f) { t = 0.0f; return true; }
+        float disc = b * b - c;
+        if (disc < 0.0f || b > 0.0f) return false;
+        t = -b - std::sqrt(disc);
+        return true;
+    }
+};
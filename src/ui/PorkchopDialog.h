@@ -0,0 +1,171 @@
+#pragma once
+
+#include <QDialog>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QImage>
+#include <QPixmap>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QApplication>
+#include <cmath>
+
+#include "../core/PhysicsEngine.h"
+#include "../core/Porkchop.h"
+
+// Окна запуска между телами текущего сценария: сетка задач Ламберта
+// (дата отправления x дата прибытия) и тепловая карта суммарного deltaV.
+// Даты — сутки от текущего модельного времени.
+class PorkchopDialog : public QDialog {
+public:
+    PorkchopDialog(PhysicsEngine& physics, QWidget* parent = nullptr)
+        : QDialog(parent), m_physics(physics) {
+        setWindowTitle("Launch windows (porkchop)");
+
+        auto form = new QFormLayout();
+        m_from = new QComboBox(this);
+        m_to = new QComboBox(this);
+        for (const auto& body : physics.bodies) {
+            m_from->addItem(body.name);
+            m_to->addItem(body.name);
+        }
+        if (m_from->findText("Earth") >= 0) m_from->setCurrentIndex(m_from->findText("Earth"));
+        if (m_to->findText("Mars") >= 0) m_to->setCurrentIndex(m_to->findText("Mars"));
+        form->addRow("From:", m_from);
+        form->addRow("To:", m_to);
+
+        m_departFrom = daysBox(0.0);
+        m_departTo = daysBox(730.0);
+        m_arriveFrom = daysBox(100.0);
+        m_arriveTo = daysBox(1100.0);
+        auto departRow = new QHBoxLayout();
+        departRow->addWidget(m_departFrom); departRow->addWidget(m_departTo);
+        auto arriveRow = new QHBoxLayout();
+        arriveRow->addWidget(m_arriveFrom); arriveRow->addWidget(m_arriveTo);
+        form->addRow("Departure, days:", departRow);
+        form->addRow("Arrival, days:", arriveRow);
+
+        m_size = new QSpinBox(this);
+        m_size->setRange(10, 2000);
+        m_size->setValue(500);
+        form->addRow("Grid:", m_size);
+
+        auto buttons = new QHBoxLayout();
+        auto btnCompute = new QPushButton("Compute", this);
+        m_btnExport = new QPushButton("Export CSV", this);
+        m_btnExport->setEnabled(false);
+        buttons->addWidget(btnCompute);
+        buttons->addWidget(m_btnExport);
+        connect(btnCompute, &QPushButton::clicked, this, [this]() { compute(); });
+        connect(m_btnExport, &QPushButton::clicked, this, [this]() { exportCsv(); });
+
+        m_map = new QLabel(this);
+        m_map->setMinimumSize(kMapSize, kMapSize);
+        m_map->setAlignment(Qt::AlignCenter);
+        m_map->setStyleSheet("background-color: #1e1e1e;");
+        m_summary = new QLabel(this);
+        m_summary->setWordWrap(true);
+
+        auto layout = new QVBoxLayout(this);
+        layout->addLayout(form);
+        layout->addLayout(buttons);
+        layout->addWidget(m_map, 1);
+        layout->addWidget(m_summary);
+    }
+
+private:
+    static constexpr int kMapSize = 500;
+    static constexpr double kDay = 86400.0;
+
+    PhysicsEngine& m_physics;
+    PorkchopGrid m_grid;
+
+    QComboBox *m_from, *m_to;
+    QDoubleSpinBox *m_departFrom, *m_departTo, *m_arriveFrom, *m_arriveTo;
+    QSpinBox* m_size;
+    QPushButton* m_btnExport;
+    QLabel *m_map, *m_summary;
+
+    QDoubleSpinBox* daysBox(double value) {
+        auto box = new QDoubleSpinBox(this);
+        box->setRange(0.0, 36500.0);
+        box->setDecimals(1);
+        box->setValue(value);
+        return box;
+    }
+
+    void compute() {
+        const double now = m_physics.time();
+        PorkchopRequest req;
+        req.departureBody = m_from->currentIndex();
+        req.arrivalBody = m_to->currentIndex();
+        req.departureStart = now + m_departFrom->value() * kDay;
+        req.departureEnd = now + std::max(m_departFrom->value(), m_departTo->value()) * kDay;
+        req.arrivalStart = now + m_arriveFrom->value() * kDay;
+        req.arrivalEnd = now + std::max(m_arriveFrom->value(), m_arriveTo->value()) * kDay;
+        req.departureCount = req.arrivalCount = m_size->value();
+
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        std::string error;
+        const bool ok = computePorkchop(m_physics.snapshot(), req, m_grid, &error);
+        QApplication::restoreOverrideCursor();
+        if (!ok) {
+            QMessageBox::warning(this, "Porkchop", QString::fromStdString(error));
+            return;
+        }
+        render();
+        m_btnExport->setEnabled(true);
+    }
+
+    // Отправление — по горизонтали, прибытие — снизу вверх; цвет — deltaV
+    // в логарифмической шкале от минимума до 4 минимумов, дальше — темный
+    void render() {
+        int bi, bj;
+        if (!m_grid.best(bi, bj)) {
+            m_summary->setText("No transfers in the grid.");
+            m_map->clear();
+            return;
+        }
+        const float best = m_grid.deltaV[m_grid.index(bi, bj)];
+        const int w = m_grid.departureCount, h = m_grid.arrivalCount;
+        QImage image(w, h, QImage::Format_RGB32);
+        for (int i = 0; i < w; ++i) {
+            for (int j = 0; j < h; ++j) {
+                const float dv = m_grid.deltaV[m_grid.index(i, j)];
+                QRgb color = qRgb(30, 30, 30);
+                if (!std::isnan(dv)) {
+                    const double x = std::log(dv / best) / std::log(4.0); // 0 — лучший, 1 — в 4 раза хуже
+                    if (x < 1.0) color = QColor::fromHsvF(0.66 * x, 1.0, 1.0 - 0.5 * x).rgb();
+                    if (i == bi && j == bj) color = qRgb(255, 255, 255);
+                }
+                image.setPixel(i, h - 1 - j, color);
+            }
+        }
+        m_map->setPixmap(QPixmap::fromImage(image).scaled(kMapSize, kMapSize, Qt::IgnoreAspectRatio, Qt::FastTransformation));
+
+        const size_t cell = m_grid.index(bi, bj);
+        const double now = m_physics.time();
+        m_summary->setText(QString("Best: depart day %1, arrive day %2 (%3 days)  C3 %4 km²/s²  "
+                                   "v∞ arrival %5 km/s  Σ %6 km/s   [%7×%8 in %9 s]")
+            .arg((m_grid.departureTimes[bi] - now) / kDay, 0, 'f', 1)
+            .arg((m_grid.arrivalTimes[bj] - now) / kDay, 0, 'f', 1)
+            .arg((m_grid.arrivalTimes[bj] - m_grid.departureTimes[bi]) / kDay, 0, 'f', 1)
+            .arg(m_grid.c3[cell] * 1e-6, 0, 'f', 3)
+            .arg(m_grid.vInfArrival[cell] * 1e-3, 0, 'f', 3)
+            .arg(m_grid.deltaV[cell] * 1e-3, 0, 'f', 3)
+            .arg(w).arg(h).arg(m_grid.seconds, 0, 'f', 2));
+    }
+
+    void exportCsv() {
+        QString fileName = QFileDialog::getSaveFileName(this, "Export porkchop", "", "CSV (*.csv)");
+        if (fileName.isEmpty()) return;
+        if (!writePorkchopCsv(fileName.toStdString(), m_grid))
+            QMessageBox::warning(this, "Porkchop", "Cannot write " + fileName);
+    }
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <QVector3D>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// История следа с адаптивным прореживанием при фиксированном бюджете вершин.
+//
+// 1. Потоковое упрощение: точка становится вершиной, только когда прямая от
+//    последней вершины до текущего положения отклоняется от пройденного пути
+//    больше допуска (допуск задается в единицах сцены из ошибки в пикселях).
+//    На прямых участках вершин почти нет, на изгибах — столько, сколько нужно.
+// 2. Уровни детализации: уровень 0 — свежие вершины с допуском tol, уровень i —
+//    с допуском tol * 2^i. Переполненный уровень отдает старшую половину
+//    следующему, упрощая ее Дугласом—Пекером с его допуском. Последний уровень
+//    при переполнении отбрасывает самые старые вершины.
+// Итого: полные орбиты даже у Нептуна и Плутона, а память и объем
+// загрузки на GPU ограничены бюджетом.
+class TrailHistory {
+public:
+    // Что поменялось после push: от этого зависит объем загрузки на GPU
+    enum class Change {
+        HeadOnly,  // Только текущее положение (последняя вершина полосы)
+        Appended,  // Добавились вершины в конец, старые на месте
+        Rebuilt    // Уровни перестроены — перезалить все
+    };
+
+    explicit TrailHistory(int vertexBudget = 1024, int levels = 4)
+        : m_levels(std::max(1, levels)) {
+        m_capacity = std::max(8, vertexBudget / (int)m_levels.size());
+        m_levelTolerance.assign(m_levels.size(), 0.0f);
+    }
+
+    // Допуск для новых вершин, в единицах сцены
+    void setTolerance(float tolerance) { m_tolerance = std::max(tolerance, 1e-6f); }
+    float tolerance() const { return m_tolerance; }
+
+    // Максимум вершин в полосе (все уровни + текущее положение)
+    int maxVertices() const { return m_capacity * (int)m_levels.size() + 1; }
+
+    int committedCount() const { return m_committed; }
+
+    Change push(const QVector3D& p) {
+        m_head = p;
+        if (!m_hasAnchor) {
+            m_hasAnchor = true;
+            m_anchor = p;
+            return commit(p);
+        }
+
+        if (fitsChord(p)) {
+            // Стоит на месте — точку не храним
+            if (m_pending.empty() || (p - m_pending.back()).lengthSquared() > 0.0f) m_pending.push_back(p);
+            // Длинный прямой участок: проверке хватит каждой второй точки
+            if ((int)m_pending.size() > kMaxWindow) {
+                for (int k = 1; k < (int)m_pending.size() / 2; ++k) m_pending[k] = m_pending[2 * k];
+                m_pending.resize(m_pending.size() / 2);
+                m_pending.back() = p;
+            }
+            return Change::HeadOnly;
+        }
+
+        // Хорда больше не покрывает путь: фиксируем предыдущую точку
+        QVector3D vertex = m_pending.empty() ? p : m_pending.back();
+        m_anchor = vertex;
+        m_pending.clear();
+        if ((p - vertex).lengthSquared() > 0.0f) m_pending.push_back(p);
+        return commit(vertex);
+    }
+
+    void clear() {
+        for (auto& level : m_levels) level.clear();
+        std::fill(m_levelTolerance.begin(), m_levelTolerance.end(), 0.0f);
+        m_pending.clear();
+        m_hasAnchor = false;
+        m_committed = 0;
+    }
+
+    const QVector3D& head() const { return m_head; }
+
+    // Вершины от старых к новым (без текущего положения)
+    void collect(std::vector<QVector3D>& out) const {
+        out.clear();
+        out.reserve(m_committed);
+        for (int i = (int)m_levels.size() - 1; i >= 0; --i) {
+            out.insert(out.end(), m_levels[i].begin(), m_levels[i].end());
+        }
+    }
+
+    // Зафиксированная вершина по номеру от старых к новым (для дозагрузки после Appended)
+    QVector3D committed(int index) const {
+        for (int i = (int)m_levels.size() - 1; i >= 0; --i) {
+            if (index < (int)m_levels[i].size()) return m_levels[i][index];
+            index -= (int)m_levels[i].size();
+        }
+        return m_head;
+    }
+
+private:
+    // Окно потокового упрощения: дальше точки прореживаются вдвое — цена проверки хорды ограничена
+    static constexpr int kMaxWindow = 256;
+
+    std::vector<std::vector<QVector3D>> m_levels; // [0] — самые свежие
+    std::vector<float> m_levelTolerance;          // Фактический допуск уровня
+    int m_capacity = 256;
+    int m_committed = 0;
+
+    float m_tolerance = 0.1f;
+    bool m_hasAnchor = false;
+    QVector3D m_anchor;
+    QVector3D m_head;
+    std::vector<QVector3D> m_pending; // Пройдено после последней вершины
+
+    static float distToSegment2(const QVector3D& q, const QVector3D& a, const QVector3D& b) {
+        QVector3D ab = b - a;
+        float len2 = ab.lengthSquared();
+        float t = (len2 > 0.0f) ? std::clamp(QVector3D::dotProduct(q - a, ab) / len2, 0.0f, 1.0f) : 0.0f;
+        return (q - (a + ab * t)).lengthSquared();
+    }
+
+    // Все пройденные точки в пределах допуска от хорды anchor -> p
+    bool fitsChord(const QVector3D& p) const {
+        const float tol2 = m_tolerance * m_tolerance;
+        for (const auto& q : m_pending) {
+            if (distToSegment2(q, m_anchor, p) > tol2) return false;
+        }
+        return true;
+    }
+
+    Change commit(const QVector3D& vertex) {
+        m_levels[0].push_back(vertex);
+        ++m_committed;
+        if (m_levelTolerance[0] == 0.0f) m_levelTolerance[0] = m_tolerance;
+        if ((int)m_levels[0].size() <= m_capacity) return Change::Appended;
+
+        for (int i = 0; i < (int)m_levels.size(); ++i) {
+            if ((int)m_levels[i].size() > m_capacity) promote(i);
+        }
+        m_committed = 0;
+        for (const auto& level : m_levels) m_committed += (int)level.size();
+        return Change::Rebuilt;
+    }
+
+    // Старшая половина уровня i уходит на уровень i+1 с вдвое большим допуском.
+    // Граничная вершина остается первой на уровне i — полоса не рвется.
+    void promote(int i) {
+        auto& level = m_levels[i];
+        const bool top = (i + 1 == (int)m_levels.size());
+        const float tol = std::max(m_levelTolerance[i], m_tolerance) * 2.0f;
+
+        if (top) {
+            // Грубее не делаем — отбрасываем самую старую историю (старые витки)
+            level.erase(level.begin(), level.begin() + (level.size() - m_capacity * 3 / 4));
+            return;
+        }
+
+        const int half = (int)level.size() / 2;
+        std::vector<QVector3D> chunk(level.begin(), level.begin() + half + 1);
+        simplify(chunk, 0, (int)chunk.size() - 1, tol);
+        auto& next = m_levels[i + 1];
+        next.insert(next.end(), chunk.begin(), chunk.end() - 1);
+        if (m_levelTolerance[i + 1] == 0.0f) m_levelTolerance[i + 1] = tol;
+        level.erase(level.begin(), level.begin() + half);
+    }
+
+    // Дуглас—Пекер на [first, last] без рекурсии; концы сохраняются
+    static void simplify(std::vector<QVector3D>& pts, int first, int last, float tolerance) {
+        if (last - first < 2) return;
+        std::vector<char> keep(pts.size(), 0);
+        keep[first] = keep[last] = 1;
+        const float tol2 = tolerance * tolerance;
+
+        std::vector<std::pair<int, int>> stack = {{first, last}};
+        while (!stack.empty()) {
+            auto [a, b] = stack.back();
+            stack.pop_back();
+            int worst = -1;
+            float worstDist = tol2;
+            for (int k = a + 1; k < b; ++k) {
+                float d = distToSegment2(pts[k], pts[a], pts[b]);
+                if (d > worstDist) { worstDist = d; worst = k; }
+            }
+            if (worst == -1) continue;
+            keep[worst] = 1;
+            stack.push_back({a, worst});
+            stack.push_back({worst, b});
+        }
+
+        int out = first;
+        for (int k = first; k <= last; ++k) {
+            if (keep[k]) pts[out++] = pts[k];
+        }
+        pts.erase(pts.begin() + out, pts.begin() + last + 1);
+    }
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <Qt3DCore/QEntity>
+#include <Qt3DCore/QTransform>
+#include <Qt3DExtras/QSphereMesh>
+#include <Qt3DExtras/QPhongMaterial>
+#include <QColor>
+#include <map>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+#include "OrbitTrail.h"
+
+struct VisualBody3D {
+    Qt3DCore::QEntity* entity;
+    Qt3DCore::QTransform* transform;
+    int physicsIndex;
+    float displayRadius; // Радиус сферы в координатах сцены (для выбора лучом)
+    OrbitTrail* trail;   // nullptr, если у тела нет следа
+};
+
+// Внешний вид тела: по нему выбираются общие сетка и материал
+struct BodyLook {
+    float radius = 3.0f;
+    int detail = 30;        // Кольца и сегменты сферы
+    QColor color = Qt::white;
+    bool emissive = false;  // Светится сам (Солнце)
+    bool trail = true;
+};
+
+// Пул визуальных тел: сущности, трансформации и следы переживают смену сценария.
+// Сетки и материалы общие и кешируются по параметрам (радиус/детализация, цвет),
+// поэтому перепривязка тела — это замена двух компонентов, а не новые объекты.
+// При смене сценария создается или убирается только разница в числе тел;
+// лишние слоты выключаются и ждут следующей загрузки. Сетки и материалы,
+// которые больше не висят ни на одном слоте, удаляются в trimSpare.
+class VisualBodyPool {
+public:
+    void attach(Qt3DCore::QEntity* root, int trailBudget = 1024) {
+        m_root = root;
+        m_trailBudget = trailBudget;
+    }
+
+    // Активные тела (первые size() слотов)
+    size_t size() const { return m_active; }
+    VisualBody3D& operator[](size_t i) { return m_bodies[i]; }
+    const VisualBody3D& operator[](size_t i) const { return m_bodies[i]; }
+    std::vector<VisualBody3D>::iterator begin() { return m_bodies.begin(); }
+    std::vector<VisualBody3D>::iterator end() { return m_bodies.begin() + m_active; }
+
+    // Сколько активных тел нужно; новые слоты создаются, лишние выключаются
+    void resize(size_t count) {
+        while (m_bodies.size() < count) createSlot();
+        for (size_t i = count; i < m_active; ++i) retire(i);
+        m_active = count;
+        trimSpare();
+    }
+
+    // Все слоты в запас (перед загрузкой другого сценария); лишние
+    // удаляются только в resize, когда известно, сколько тел понадобится
+    void release() {
+        for (size_t i = 0; i < m_active; ++i) retire(i);
+        m_active = 0;
+    }
+
+    // Привязывает слот к телу: сетка и материал из кеша, след очищается на месте
+    void bind(size_t i, int physicsIndex, const BodyLook& look, bool trailsVisible) {
+        VisualBody3D& vb = m_bodies[i];
+        Slot& slot = m_slots[i];
+        vb.physicsIndex = physicsIndex;
+        vb.displayRadius = look.radius;
+
+        swapComponent(vb.entity, slot.mesh, sphere(look.radius, look.detail));
+        swapComponent(vb.entity, slot.material, material(look.color, look.emissive));
+        vb.entity->setEnabled(true);
+
+        if (look.trail) {
+            if (!slot.trail) {
+                slot.trail = new OrbitTrail(m_root, look.color, m_trailBudget);
+            } else {
+                slot.trail->setColor(look.color);
+                slot.trail->clear();
+            }
+            slot.trail->setEnabled(trailsVisible);
+            vb.trail = slot.trail;
+        } else {
+            if (slot.trail) slot.trail->setEnabled(false);
+            vb.trail = nullptr;
+        }
+    }
+
+private:
+    // Слотов в запасе не больше, чем активных (и не меньше kMinSpare)
+    static constexpr size_t kMinSpare = 256;
+
+    struct Slot {
+        Qt3DExtras::QSphereMesh* mesh = nullptr;
+        Qt3DExtras::QPhongMaterial* material = nullptr;
+        OrbitTrail* trail = nullptr; // Живет и тогда, когда телу след не нужен
+    };
+
+    Qt3DCore::QEntity* m_root = nullptr;
+    int m_trailBudget = 1024;
+    size_t m_active = 0;
+    std::vector<VisualBody3D> m_bodies;
+    std::vector<Slot> m_slots;
+
+    std::map<std::pair<float, int>, Qt3DExtras::QSphereMesh*> m_meshes;
+    std::map<std::pair<QRgb, bool>, Qt3DExtras::QPhongMaterial*> m_materials;
+    std::map<const Qt3DCore::QComponent*, int> m_users; // Сколько слотов держат компонент кеша
+
+    void createSlot() {
+        VisualBody3D vb;
+        vb.entity = new Qt3DCore::QEntity(m_root);
+        vb.transform = new Qt3DCore::QTransform();
+        vb.entity->addComponent(vb.transform);
+        vb.physicsIndex = -1;
+        vb.displayRadius = 0.0f;
+        vb.trail = nullptr;
+        m_bodies.push_back(vb);
+        m_slots.push_back(Slot());
+    }
+
+    void retire(size_t i) {
+        m_bodies[i].entity->setEnabled(false);
+        if (m_slots[i].trail) {
+            m_slots[i].trail->setEnabled(false);
+            m_slots[i].trail->clear();
+        }
+        m_bodies[i].trail = nullptr;
+    }
+
+    // После сценария на сотни тысяч тел не держим их все ради маленького
+    void trimSpare() {
+        const size_t keep = m_active + std::max(kMinSpare, m_active);
+        for (size_t i = m_active; i < m_bodies.size(); ++i) {
+            // Запасной слот выключен: сетку и материал он получит заново в bind,
+            // а пока не держит их в кеше
+            detachComponent(m_bodies[i].entity, m_slots[i].mesh);
+            detachComponent(m_bodies[i].entity, m_slots[i].material);
+            if (i < keep) continue;
+
+            // Безопасное удаление через Qt Event Loop
+            m_bodies[i].entity->setParent((Qt3DCore::QEntity*)nullptr);
+            m_bodies[i].entity->deleteLater();
+            if (m_slots[i].trail) {
+                m_slots[i].trail->setParent((Qt3DCore::QEntity*)nullptr);
+                m_slots[i].trail->deleteLater();
+            }
+        }
+        if (m_bodies.size() > keep) {
+            m_bodies.resize(keep);
+            m_slots.resize(keep);
+        }
+
+        // Радиусы и цвета сценариев уникальны — без чистки кеш только растет
+        evictUnused(m_meshes);
+        evictUnused(m_materials);
+    }
+
+    template <typename Component>
+    void swapComponent(Qt3DCore::QEntity* entity, Component*& current, Component* next) {
+        if (current == next) return;
+        detachComponent(entity, current);
+        entity->addComponent(next);
+        ++m_users[next];
+        current = next;
+    }
+
+    template <typename Component>
+    void detachComponent(Qt3DCore::QEntity* entity, Component*& current) {
+        if (!current) return;
+        entity->removeComponent(current);
+        --m_users[current];
+        current = nullptr;
+    }
+
+    template <typename Cache>
+    void evictUnused(Cache& cache) {
+        for (auto it = cache.begin(); it != cache.end();) {
+            if (m_users[it->second] > 0) { ++it; continue; }
+            m_users.erase(it->second);
+            it->second->setParent((Qt3DCore::QNode*)nullptr);
+            it->second->deleteLater();
+            it = cache.erase(it);
+        }
+    }
+
+    // Компоненты кеша принадлежат корню сцены — одна сетка на много сущностей
+    Qt3DExtras::QSphereMesh* sphere(float radius, int detail) {
+        auto& mesh = m_meshes[{radius, detail}];
+        if (!mesh) {
+            mesh = new Qt3DExtras::QSphereMesh(m_root);
+            mesh->setRadius(radius);
+            mesh->setRings(detail);
+            mesh->setSlices(detail);
+        }
+        return mesh;
+    }
+
+    Qt3DExtras::QPhongMaterial* material(const QColor& color, bool emissive) {
+        auto& mat = m_materials[{color.rgba(), emissive}];
+        if (!mat) {
+            mat = new Qt3DExtras::QPhongMaterial(m_root);
+            mat->setDiffuse(color);
+            if (emissive) mat->setAmbient(color);
+            else { mat->setAmbient(QColor(60, 60, 60)); mat->setShininess(10.0f); }
+        }
+        return mat;
+    }
+};
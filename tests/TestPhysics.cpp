@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
 #include "../src/core/PhysicsEngine.h"
+#include "../src/core/FrameScheduler.h"
+#include "../src/core/ScenarioGenerator.h"
+#include "../src/core/SecularEvolution.h"
+#include "../src/ui/PickingGrid.h"
+#include "../src/ui/TrailHistory.h"
 #include <cmath>
+#include <random>
 
 // Тест 1: Проверка формулы гравитации
 TEST(PhysicsTest, GravitationalForceCalculation) {
@@ -8,7 +14,7 @@ TEST(PhysicsTest, GravitationalForceCalculation) {
     
     double m1 = 1.0e5; // 100 тонн
     double m2 = 2.0e5; // 200 тонн
-    double dist = 2000.0; // 2000 метров (больше лимита в 1000м)
+    double dist = 2.0e5; // 200 км: дальше мягкого ядра (r^2 < 1e10 м^2 не считается)
     
     physics.addBody(CelestialBody("Obj1", m1, 1, Qt::white, {0, 0, 0}, {0, 0, 0}));
     physics.addBody(CelestialBody("Obj2", m2, 1, Qt::white, {dist, 0, 0}, {0, 0, 0}));
@@ -27,7 +33,7 @@ TEST(PhysicsTest, GravitationalForceCalculation) {
     double actualAcc1 = physics.bodies[0].acceleration.norm();
     
     // Сравниваем
-    EXPECT_NEAR(actualAcc1, expectedAcc1, 1e-15);
+    EXPECT_NEAR(actualAcc1, expectedAcc1, 1e-9 * expectedAcc1);
 }
 
 // Тест 2: Проверка Интегратора (двигается ли тело?)
@@ -43,4 +49,287 @@ TEST(PhysicsTest, IntegrationMovement) {
     // Новая позиция должна быть (10, 0)
     EXPECT_NEAR(physics.bodies[0].position.x(), 10.0, 1e-9);
     EXPECT_NEAR(physics.bodies[0].position.y(), 0.0, 1e-9);
-}
\ No newline at end of file
+}
+
+// Тест 3: Тайловое ядро совпадает с прямой суммой (границы i/j-блоков, несколько потоков)
+TEST(PhysicsTest, TiledKernelMatchesDirectSum) {
+    PhysicsEngine physics;
+    const double G = 6.67430e-11;
+
+    const int n = 1500; // больше kTileJ и не кратно размерам блоков
+    for (int k = 0; k < n; ++k) {
+        double a = 1.0e11 + 3.0e8 * k;
+        double phi = 0.37 * k;
+        physics.addBody(CelestialBody("B", 1.0e20 + 1.0e17 * k, 1, Qt::white,
+                                      {a * std::cos(phi), a * std::sin(phi), 1.0e7 * (k % 7)}, {0, 0, 0}));
+    }
+
+    // dt = 0: позиции не меняются, в acceleration остается a(t)
+    physics.step(0.0);
+
+    for (int i : {0, 63, 64, 511, 512, 1499}) {
+        Eigen::Vector3d expected(0, 0, 0);
+        for (int j = 0; j < n; ++j) {
+            Eigen::Vector3d r = physics.bodies[j].position - physics.bodies[i].position;
+            double d2 = r.squaredNorm();
+            if (d2 < 1e10) continue;
+            expected += r * (G * physics.bodies[j].mass / (d2 * std::sqrt(d2)));
+        }
+        EXPECT_NEAR((physics.bodies[i].acceleration - expected).norm(), 0.0, 1e-12 * expected.norm());
+    }
+}
+
+// Тест 4: Ускорение симуляции = больше шагов фиксированного размера, а не больший dt
+TEST(PhysicsTest, FrameSchedulerSubstepsAtFixedDt) {
+    PhysicsEngine physics;
+    physics.addBody(CelestialBody("Runner", 10, 1, Qt::white, {0, 0, 0}, {10, 0, 0}));
+
+    FrameScheduler scheduler;
+    scheduler.fixedStep = 1.0;
+    scheduler.frameBudget = 1.0;
+
+    // 5x: пять шагов по 1 с за кадр
+    FrameReport report = scheduler.advance(physics, 5.0);
+    EXPECT_EQ(report.substeps, 5);
+    EXPECT_FALSE(report.behind);
+    EXPECT_NEAR(physics.bodies[0].position.x(), 50.0, 1e-9);
+
+    // 0.5x: шаг через кадр, остаток копится
+    EXPECT_EQ(scheduler.advance(physics, 0.5).substeps, 0);
+    EXPECT_EQ(scheduler.advance(physics, 0.5).substeps, 1);
+
+    // Нулевой бюджет: один шаг и честный отчет об отставании
+    scheduler.frameBudget = 0.0;
+    report = scheduler.advance(physics, 100.0);
+    EXPECT_EQ(report.substeps, 1);
+    EXPECT_TRUE(report.behind);
+    EXPECT_LE(scheduler.accumulator(), 100.0);
+}
+
+TEST(TrailTest, AdaptiveHistoryKeepsFullOrbitsWithinBudget) {
+    // Медленная орбита (Нептун: ~60000 кадров на виток) и быстрая, по три витка
+    for (int perOrbit : {365, 60000}) {
+        TrailHistory history(1024);
+        history.setTolerance(0.4f);
+        const float R = 3000.0f;
+        for (int f = 0; f < 3 * perOrbit; ++f) {
+            double a = 2.0 * 3.14159265358979 * f / perOrbit;
+            history.push(QVector3D(R * (float)std::cos(a), 0.0f, R * (float)std::sin(a)));
+        }
+
+        std::vector<QVector3D> v;
+        history.collect(v);
+        EXPECT_LE((int)v.size() + 1, history.maxVertices());
+
+        // Суммарный угол, покрытый следом: все три витка на месте
+        double turns = 0.0;
+        for (size_t i = 1; i < v.size(); ++i) {
+            double d = std::atan2(v[i].z(), v[i].x()) - std::atan2(v[i - 1].z(), v[i - 1].x());
+            while (d < 0.0) d += 2.0 * 3.14159265358979;
+            turns += d / (2.0 * 3.14159265358979);
+        }
+        EXPECT_NEAR(turns, 3.0, 0.02);
+
+        // Свежий виток (последние вершины) — в пределах допуска уровня 0
+        for (size_t i = v.size() - 20; i < v.size(); ++i) {
+            QVector3D mid = (v[i - 1] + v[i]) * 0.5f;
+            EXPECT_LT(R - std::sqrt(mid.lengthSquared()), 0.4f * 1.01f);
+        }
+    }
+}
+
+TEST(PickingTest, GridMatchesBruteForceRaySphere) {
+    // Перебор: ближайшее t >= 0 по всем сферам (0, если начало луча внутри)
+    auto bruteForce = [](const std::vector<QVector3D>& c, const std::vector<float>& r,
+                         const QVector3D& origin, QVector3D dir) {
+        dir.normalize();
+        float best = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < c.size(); ++i) {
+            QVector3D oc = origin - c[i];
+            float b = QVector3D::dotProduct(oc, dir);
+            float cc = oc.lengthSquared() - r[i] * r[i];
+            if (cc <= 0.0f) { best = 0.0f; continue; }
+            float disc = b * b - cc;
+            if (disc < 0.0f || b > 0.0f) continue;
+            best = std::min(best, -b - std::sqrt(disc));
+        }
+        return best;
+    };
+    auto hitDistance = [](const std::vector<QVector3D>& c, const std::vector<float>& r,
+                          int body, const QVector3D& origin, QVector3D dir) {
+        dir.normalize();
+        QVector3D oc = origin - c[body];
+        float b = QVector3D::dotProduct(oc, dir);
+        float cc = oc.lengthSquared() - r[body] * r[body];
+        return cc <= 0.0f ? 0.0f : -b - std::sqrt(std::max(0.0f, b * b - cc));
+    };
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> pos(-500.0f, 500.0f), rad(0.5f, 6.0f), unit(-1.0f, 1.0f);
+    const int n = 4000;
+    std::vector<QVector3D> centers(n);
+    std::vector<float> radii(n);
+    for (int i = 0; i < n; ++i) {
+        centers[i] = QVector3D(pos(rng), pos(rng), 0.1f * pos(rng)); // Плоский диск, как орбиты
+        radii[i] = rad(rng);
+    }
+
+    PickingGrid grid;
+    auto check = [&](const char* what) {
+        int hits = 0;
+        std::vector<std::pair<QVector3D, QVector3D>> rays;
+        for (int k = 0; k < 300; ++k) {
+            // Снаружи: из точки на сфере радиуса 2000 в сторону случайного тела
+            QVector3D from(unit(rng), unit(rng), unit(rng));
+            from.normalize();
+            from = from * 2000.0f;
+            rays.push_back({from, centers[k % n] + QVector3D(unit(rng), unit(rng), unit(rng)) * 4.0f - from});
+            // Изнутри сетки, в произвольном направлении
+            rays.push_back({QVector3D(pos(rng), pos(rng), 0.1f * pos(rng)), QVector3D(unit(rng), unit(rng), unit(rng))});
+            // Вдоль осей, изнутри и снаружи
+            const int axis = k % 3;
+            QVector3D dir(0.0f, 0.0f, 0.0f), origin = centers[(7 * k) % n];
+            dir[axis] = (k % 2) ? 1.0f : -1.0f;
+            origin[axis] -= dir[axis] * 1500.0f * (k % 4 < 2 ? 1.0f : 0.0f);
+            rays.push_back({origin, dir});
+        }
+        for (const auto& ray : rays) {
+            const float expected = bruteForce(centers, radii, ray.first, ray.second);
+            const int body = grid.pick(ray.first, ray.second);
+            if (expected == std::numeric_limits<float>::max()) {
+                EXPECT_EQ(body, -1) << what;
+                continue;
+            }
+            ASSERT_NE(body, -1) << what;
+            EXPECT_NEAR(hitDistance(centers, radii, body, ray.first, ray.second), expected, 1e-3f * (1.0f + expected)) << what;
+            ++hits;
+        }
+        EXPECT_GT(hits, 300) << what;
+    };
+
+    EXPECT_TRUE(grid.update(centers, radii));
+    check("fresh grid");
+
+    // Сдвиг меньше запаса: центры подменяются без перестройки
+    for (auto& c : centers) c += QVector3D(unit(rng), unit(rng), unit(rng)) * 0.01f;
+    EXPECT_FALSE(grid.update(centers, radii));
+    check("refreshed centers");
+
+    // Тело ушло далеко — перестройка
+    centers[0] += QVector3D(300.0f, 0.0f, 0.0f);
+    EXPECT_TRUE(grid.update(centers, radii));
+    check("rebuilt grid");
+}
+
+TEST(EventTest, PerihelionAndCloseApproachAreLocalizedBetweenSteps) {
+    // Эксцентричная орбита, старт в афелии: перигелий ровно через полпериода
+    const double M = 1.989e30, a = 1.496e11, e = 0.5;
+    const double mu = NBodyEngine::G * M;
+    const double ra = a * (1.0 + e);
+    const double va = std::sqrt(mu / a * (1.0 - e) / (1.0 + e));
+    const double period = 2.0 * 3.14159265358979 * std::sqrt(a * a * a / mu);
+
+    PhysicsEngine physics;
+    physics.currentIntegrator = IntegratorType::RungeKutta4;
+    physics.addBody(CelestialBody("Sun", M, 1, Qt::yellow, {0, 0, 0}, {0, 0, 0}));
+    physics.addBody(CelestialBody("Comet", 0.0, 1, Qt::white, {ra, 0, 0}, {0, va, 0}));
+    // Два безмассовых тела далеко от Солнца летят навстречу по параллельным прямым в 5e8 м друг от друга
+    physics.addBody(CelestialBody("A", 0.0, 1, Qt::white, {1e14, 0, 0}, {1000, 0, 0}));
+    physics.addBody(CelestialBody("B", 0.0, 1, Qt::white, {1e14 + 2.0e9, 5e8, 0}, {-1000, 0, 0}));
+
+    physics.events.watchApsides(1, 0);
+    physics.events.setCloseApproachDistance(1e9);
+
+    std::vector<SimEvent> found;
+    const double dt = 3600.0;
+    for (int s = 0; s * dt < 0.6 * period; ++s) {
+        physics.step(dt);
+        for (const auto& ev : physics.events.takeEvents()) found.push_back(ev);
+    }
+
+    bool perihelion = false, approach = false;
+    for (const auto& ev : found) {
+        if (ev.kind == EventKind::Periapsis && ev.body == 1) {
+            perihelion = true;
+            EXPECT_NEAR(ev.time, 0.5 * period, 1.0);
+            EXPECT_NEAR(ev.value, a * (1.0 - e), 1e3);
+        }
+        if (ev.kind == EventKind::CloseApproach) {
+            approach = true;
+            EXPECT_EQ(std::min(ev.body, ev.other), 2);
+            EXPECT_NEAR(ev.time, 1.0e6, 1e-2);  // Встреча через 2e9 / 2000 м/с
+            EXPECT_NEAR(ev.value, 5e8, 1.0);
+        }
+    }
+    EXPECT_TRUE(perihelion);
+    EXPECT_TRUE(approach);
+}
+
+// Вековой режим: коэффициенты Лапласа против гипергеометрического ряда,
+// сохранение дефицита углового момента (инвариант теории) и передача
+// состояния обратно в N-body вместе со спутником
+TEST(SecularTest, LaplaceLagrangeInvariantsAndHandBack) {
+    // b_3/2^(j)(a) = 2 (3/2)_j / j! a^j F(3/2, 3/2 + j; j + 1; a^2)
+    auto series = [](int j, double a) {
+        double pochhammer = 1.0, factorial = 1.0;
+        for (int k = 0; k < j; ++k) { pochhammer *= 1.5 + k; factorial *= k + 1; }
+        double term = 1.0, sum = 1.0;
+        for (int n = 0; n < 200; ++n) {
+            term *= (1.5 + n) * (1.5 + j + n) / ((j + 1.0 + n) * (n + 1.0)) * a * a;
+            sum += term;
+        }
+        return 2.0 * pochhammer / factorial * std::pow(a, j) * sum;
+    };
+    double b1, b2;
+    SecularEvolution::laplaceCoefficients(0.5, b1, b2);
+    EXPECT_NEAR(b1, series(1, 0.5), 1e-12);
+    EXPECT_NEAR(b2, series(2, 0.5), 1e-12);
+
+    const double M = 1.989e30, AU = 1.496e11, year = 365.25 * 86400.0;
+    const double mu = NBodyEngine::G * M;
+    Eigen::Vector3d r, v;
+    PhysicsEngine physics;
+    physics.addBody(CelestialBody("Sun", M, 1, Qt::yellow, {0, 0, 0}, {0, 0, 0}));
+    scenario_gen::keplerToState(mu, AU, 0.05, 0.02, 0.5, 1.0, 0.0, r, v);
+    physics.addBody(CelestialBody("Earth", 5.972e24, 1, Qt::blue, r, v));
+    physics.addBody(CelestialBody("Moon", 7.342e22, 1, Qt::gray, r + Eigen::Vector3d(3.844e8, 0, 0), v + Eigen::Vector3d(0, 1022, 0)));
+    scenario_gen::keplerToState(mu, 5.2 * AU, 0.048, 0.01, 2.0, 4.0, 1.0, r, v);
+    physics.addBody(CelestialBody("Jupiter", 1.898e27, 1, Qt::red, r, v));
+    ASSERT_TRUE(physics.setParent(2, 1));
+    ASSERT_TRUE(physics.enterSecular());
+
+    // Сумма Lambda (e^2, i^2) по планетам в теории Лапласа—Лагранжа постоянна
+    const SecularEvolution& secular = physics.secularState();
+    auto deficit = [&](bool inclination) {
+        double sum = 0.0;
+        for (int b : {1, 3}) {
+            const SecularEvolution::Elements el = secular.elements(b);
+            const double x = inclination ? el.inc : el.e;
+            sum += physics.bodies[b].mass * std::sqrt(el.a) * x * x;
+        }
+        return sum;
+    };
+    const double eccDeficit = deficit(false), incDeficit = deficit(true);
+    const double earthE0 = secular.elements(1).e;
+
+    physics.step(1e6 * year); // Один шаг на миллион лет
+    EXPECT_NEAR(physics.time(), 1e6 * year, 1.0);
+    EXPECT_NEAR(deficit(false), eccDeficit, 1e-9 * eccDeficit);
+    EXPECT_NEAR(deficit(true), incDeficit, 1e-9 * incDeficit);
+    EXPECT_GT(std::fabs(secular.elements(1).e - earthE0), 1e-3); // Эксцентриситет Земли действительно менялся
+
+    // Полуось сохраняется, Луна при Земле
+    const Eigen::Vector3d earth = physics.bodies[1].position - physics.bodies[0].position;
+    EXPECT_GT(earth.norm(), 0.85 * AU);
+    EXPECT_LT(earth.norm(), 1.15 * AU);
+    EXPECT_NEAR((physics.bodies[2].position - physics.bodies[1].position).norm(), 3.844e8, 0.1 * 3.844e8);
+
+    // Обратно в N-body: месяц шагов по суткам, Луна остается связанной
+    physics.leaveSecular();
+    EXPECT_FALSE(physics.inSecularMode());
+    for (int s = 0; s < 30; ++s) physics.step(86400.0);
+    const Eigen::Vector3d dr = physics.bodies[2].position - physics.bodies[1].position;
+    const Eigen::Vector3d dv = physics.bodies[2].velocity - physics.bodies[1].velocity;
+    EXPECT_LT(0.5 * dv.squaredNorm() - NBodyEngine::G * (5.972e24 + 7.342e22) / dr.norm(), 0.0);
+    EXPECT_NEAR(physics.time(), 1e6 * year + 30 * 86400.0, 1.0);
+}
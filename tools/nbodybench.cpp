@@ -0,0 +1,103 @@
+// nbodybench — время шага N-body на разном числе потоков.
+//
+//   nbodybench [--count N] [--steps S] [--threads 1,2,4,...] [--integrator verlet|rk4]
+//
+// Скопление Пламмера из N звезд шагается S раз на каждом числе потоков
+// (по умолчанию 1, 2, 4 ... до omp_get_max_threads()); печатается время
+// шага, ускорение относительно первой строки (в пересчете на один поток)
+// и эффективность. Потоков больше, чем ядер, — ускорения не будет, и строка
+// помечается как oversubscribed. Разбиение ownedRange не меняет порядок суммирования сил,
+// поэтому конечное состояние обязано совпасть побитно при любом числе
+// потоков — иначе код возврата 1.
+// Для NUMA-машин запускать с OMP_PLACES=cores.
+
+#include "core/NBodyEngine.h"
+#include "core/ScenarioGenerator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* option(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 0; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    return fallback;
+}
+
+int usage() {
+    std::fprintf(stderr, "usage:\n  nbodybench [--count N] [--steps S] [--threads 1,2,4,...] [--integrator verlet|rk4]\n");
+    return 2;
+}
+
+std::vector<int> threadCounts(const char* list) {
+    std::vector<int> out;
+    if (list) {
+        for (const char* p = list; *p;) {
+            const int t = std::atoi(p);
+            if (t > 0) out.push_back(t);
+            p = std::strchr(p, ',');
+            if (!p) break;
+            ++p;
+        }
+        return out;
+    }
+    const int maxThreads = omp_get_max_threads();
+    for (int t = 1; t < maxThreads; t *= 2) out.push_back(t);
+    out.push_back(maxThreads);
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) return usage();
+
+    const int count = std::atoi(option(argc, argv, "--count", "20000"));
+    const int steps = std::atoi(option(argc, argv, "--steps", "5"));
+    const std::string integrator = option(argc, argv, "--integrator", "verlet");
+    const std::vector<int> threads = threadCounts(option(argc, argv, "--threads", nullptr));
+    if (count <= 0 || steps <= 0 || threads.empty() || (integrator != "verlet" && integrator != "rk4")) return usage();
+
+    const GeneratedPopulation cluster = generatePopulation(PopulationParams::plummerCluster(count, 1));
+    const double dt = 3.15e9; // ~100 лет: время пересечения скопления ~10^6 лет
+
+    std::printf("%d bodies, %d %s steps, %d hardware threads\n", count, steps, integrator.c_str(), omp_get_num_procs());
+    std::printf("threads  ms/step  speedup  efficiency\n");
+
+    double base = 0.0;
+    std::vector<Eigen::Vector3d> reference;
+    bool identical = true;
+    for (int t : threads) {
+        omp_set_num_threads(t);
+        // Движок собирается заново: массивы тел размещаются потоками этого прогона
+        NBodyEngine engine;
+        engine.currentIntegrator = integrator == "rk4" ? IntegratorType::RungeKutta4 : IntegratorType::Verlet;
+        cluster.appendTo(engine);
+        engine.step(dt); // Разогрев: размещение массивов и буферов
+
+        const auto t0 = Clock::now();
+        for (int s = 0; s < steps; ++s) engine.step(dt);
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / steps;
+
+        if (base == 0.0) base = ms * t;
+        const double speedup = base / ms;
+        std::printf("%7d  %7.2f  %7.2f  %9.0f%%%s\n", t, ms, speedup, 100.0 * speedup / t,
+                    t > omp_get_num_procs() ? "  (oversubscribed)" : "");
+
+        if (reference.empty()) reference = engine.positions;
+        else if (engine.positions != reference) identical = false;
+    }
+
+    if (!identical) {
+        std::fprintf(stderr, "FAILED: state depends on thread count\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// porkchop — окна запуска между телами сценария.
+//
+//   porkchop <scenario.json> <from> <to> [--depart D0:D1:N] [--arrive A0:A1:M]
+//            [--step S] [--csv out.csv]
+//   porkchop check [--size N]
+//
+// Даты — сутки модельного времени от начала сценария. Положения тел
+// берутся из распространения самого сценария (RK4, шаг --step суток),
+// в каждой клетке решается задача Ламберта; итог — C3 отлета,
+// гиперболический избыток прибытия и их сумма, по желанию в CSV.
+// check сверяет решатель Ламберта с опорным примером, минимум сетки
+// Земля—Марс с гомановским перелетом и меряет скорость на сетке N x N.
+
+#include "core/ScenarioFile.h"
+#include "core/Porkchop.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr double Day = 86400.0;
+constexpr double AU = 1.496e11;
+
+const char* option(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 0; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    return fallback;
+}
+
+int usage() {
+    std::fprintf(stderr,
+        "usage:\n"
+        "  porkchop <scenario.json> <from> <to> [--depart D0:D1:N] [--arrive A0:A1:M]\n"
+        "           [--step days] [--csv out.csv]\n"
+        "  porkchop check [--size N]\n");
+    return 2;
+}
+
+// "a:b:n" -> диапазон в сутках и число узлов
+bool parseRange(const char* text, double& a, double& b, int& n) {
+    return text && std::sscanf(text, "%lf:%lf:%d", &a, &b, &n) == 3 && n > 0 && b >= a;
+}
+
+void printBest(const PorkchopGrid& grid) {
+    int i, j;
+    if (!grid.best(i, j)) { std::printf("no transfers in the grid\n"); return; }
+    const size_t cell = grid.index(i, j);
+    std::printf("best: depart day %.1f, arrive day %.1f (%.1f days), C3 %.3f km^2/s^2, "
+                "v_inf arrival %.3f km/s, total %.3f km/s\n",
+                grid.departureTimes[i] / Day, grid.arrivalTimes[j] / Day,
+                (grid.arrivalTimes[j] - grid.departureTimes[i]) / Day,
+                grid.c3[cell] * 1e-6, grid.vInfArrival[cell] * 1e-3, grid.deltaV[cell] * 1e-3);
+}
+
+int run(int argc, char** argv) {
+    if (argc < 4) return usage();
+    std::vector<ScenarioBody> scenario;
+    if (!readScenario(argv[1], scenario) || scenario.empty()) { std::fprintf(stderr, "cannot load %s\n", argv[1]); return 1; }
+
+    NBodyEngine engine;
+    engine.currentIntegrator = IntegratorType::RungeKutta4;
+    for (const auto& b : scenario) engine.addBody(b.mass, b.position, b.velocity);
+    const std::vector<int> parents = scenarioParents(scenario);
+    for (int i = 0; i < (int)parents.size(); ++i)
+        if (parents[i] >= 0) engine.setParent(i, parents[i]);
+
+    PorkchopRequest req;
+    for (int i = 0; i < (int)scenario.size(); ++i) {
+        if (scenario[i].name == argv[2]) req.departureBody = i;
+        if (scenario[i].name == argv[3]) req.arrivalBody = i;
+    }
+    if (req.departureBody < 0 || req.arrivalBody < 0) { std::fprintf(stderr, "unknown body name\n"); return 1; }
+
+    double d0 = 0, d1 = 730, a0 = 100, a1 = 1100;
+    int dn = 365, an = 500;
+    if (!parseRange(option(argc, argv, "--depart", "0:730:365"), d0, d1, dn) ||
+        !parseRange(option(argc, argv, "--arrive", "100:1100:500"), a0, a1, an)) return usage();
+    req.departureStart = d0 * Day; req.departureEnd = d1 * Day; req.departureCount = dn;
+    req.arrivalStart = a0 * Day; req.arrivalEnd = a1 * Day; req.arrivalCount = an;
+    req.ephemerisStep = std::atof(option(argc, argv, "--step", "1")) * Day;
+
+    PorkchopGrid grid;
+    std::string error;
+    if (!computePorkchop(engine, req, grid, &error)) { std::fprintf(stderr, "%s\n", error.c_str()); return 1; }
+    std::printf("%d x %d cells in %.3f s\n", grid.departureCount, grid.arrivalCount, grid.seconds);
+    printBest(grid);
+
+    if (const char* csv = option(argc, argv, "--csv", nullptr)) {
+        if (!writePorkchopCsv(csv, grid)) { std::fprintf(stderr, "cannot write %s\n", csv); return 1; }
+    }
+    return 0;
+}
+
+int check(int argc, char** argv) {
+    const int size = std::atoi(option(argc, argv, "--size", "1000"));
+    bool ok = true;
+
+    // 1. Опорный пример (Curtis, Orbital Mechanics for Engineering Students, пример 5.2)
+    {
+        const double mu = 398600e9;
+        Eigen::Vector3d r1(5000e3, 10000e3, 2100e3), r2(-14600e3, 2500e3, 7000e3), v1, v2;
+        const bool solved = lambert::solve(r1, r2, 3600.0, mu, Eigen::Vector3d::UnitZ(), v1, v2);
+        const double err1 = solved ? (v1 - Eigen::Vector3d(-5992.5, 1925.4, 3245.6)).norm() : 1e9;
+        const double err2 = solved ? (v2 - Eigen::Vector3d(-3312.5, -4196.6, -385.29)).norm() : 1e9;
+        const bool pass = err1 < 1.0 && err2 < 1.0;
+        std::printf("lambert reference: |dv1| %.3f m/s, |dv2| %.3f m/s%s\n", err1, err2, pass ? "" : "  (FAILED)");
+        ok = ok && pass;
+    }
+
+    // 2. Земля -> Марс на круговых орбитах: минимум сетки не хуже гомановского
+    //    с небольшим запасом (точный 180-градусный перелет вырожден)
+    NBodyEngine engine;
+    engine.currentIntegrator = IntegratorType::RungeKutta4;
+    const double sun = 1.989e30, mu = NBodyEngine::G * sun;
+    const double rE = 1.496e11, rM = 2.279e11;
+    engine.addBody(sun, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+    engine.addBody(5.972e24, {rE, 0, 0}, {0, std::sqrt(mu / rE), 0});
+    engine.addBody(6.417e23, {0, rM, 0}, {-std::sqrt(mu / rM), 0, 0});
+
+    const double aT = 0.5 * (rE + rM);
+    const double vInfDep = std::sqrt(mu / rE) * (std::sqrt(rM / aT) - 1.0);
+    const double vInfArr = std::sqrt(mu / rM) * (1.0 - std::sqrt(rE / aT));
+    const double hohmann = vInfDep + vInfArr;
+
+    PorkchopRequest req;
+    req.departureBody = 1; req.arrivalBody = 2;
+    req.departureStart = 0.0; req.departureEnd = 800 * Day; req.departureCount = size;
+    req.arrivalStart = 100 * Day; req.arrivalEnd = 1200 * Day; req.arrivalCount = size;
+
+    PorkchopGrid grid;
+    std::string error;
+    if (!computePorkchop(engine, req, grid, &error)) { std::fprintf(stderr, "FAILED: %s\n", error.c_str()); return 1; }
+    size_t solved = 0;
+    for (float v : grid.deltaV) solved += !std::isnan(v);
+    int bi, bj;
+    grid.best(bi, bj);
+    const double best = bi >= 0 ? grid.deltaV[grid.index(bi, bj)] : 1e30;
+    const bool pass = best >= 0.999 * hohmann && best < 1.05 * hohmann;
+    std::printf("%d x %d grid: %.3f s (%.2f M cells/s), %zu solved\n", size, size, grid.seconds,
+                (double)size * size / grid.seconds * 1e-6, solved);
+    std::printf("Earth-Mars best %.4f km/s vs Hohmann %.4f km/s%s\n", best * 1e-3, hohmann * 1e-3,
+                pass ? "" : "  (FAILED)");
+    printBest(grid);
+    ok = ok && pass;
+
+    if (!ok) { std::fprintf(stderr, "FAILED\n"); return 1; }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    if (std::strcmp(argv[1], "check") == 0) return check(argc, argv);
+    return run(argc, argv);
+}
@@ -0,0 +1,190 @@
+// scengen — процедурная генерация больших сценариев.
+//
+//   scengen <asteroids|kuiper|disk|plummer> <out.json> [--count N] [--seed S]
+//           [--base scenario.json] [--inner AU] [--outer AU]
+//   scengen check [--count N]
+//
+// Пояса и диск строятся вокруг самого массивного тела из --base (иначе
+// добавляется Солнце). Результат — обычный *.json, его открывает GUI (Load)
+// и trajcodec bench. check сверяет генерацию на 1 и на всех потоках
+// побитно и проверяет физику популяций (кеплеровы орбиты, вириал Пламмера).
+
+#include "core/ScenarioFile.h"
+#include "core/ScenarioGenerator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr double AU = 1.496e11;
+constexpr double SolarMass = 1.989e30;
+
+double seconds(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double>(b - a).count();
+}
+
+const char* option(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 0; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    return fallback;
+}
+
+int usage() {
+    std::fprintf(stderr,
+        "usage:\n"
+        "  scengen <asteroids|kuiper|disk|plummer> <out.json> [--count N] [--seed S]\n"
+        "          [--base scenario.json] [--inner AU] [--outer AU]\n"
+        "  scengen check [--count N]\n");
+    return 2;
+}
+
+bool paramsFor(const std::string& kind, int count, uint64_t seed, PopulationParams& p, const char*& color) {
+    if (kind == "asteroids") { p = PopulationParams::asteroidBelt(count, seed); color = "#a0a0a0"; }
+    else if (kind == "kuiper") { p = PopulationParams::kuiperBelt(count, seed); color = "#8fb3d9"; }
+    else if (kind == "disk") { p = PopulationParams::protoplanetaryDisk(count, seed); color = "#d9a05b"; }
+    else if (kind == "plummer") { p = PopulationParams::plummerCluster(count, seed); color = "#fff4e0"; }
+    else return false;
+    return true;
+}
+
+int generate(int argc, char** argv) {
+    if (argc < 3) return usage();
+    const int count = std::atoi(option(argc, argv, "--count", "10000"));
+    const uint64_t seed = std::strtoull(option(argc, argv, "--seed", "1"), nullptr, 10);
+    if (count <= 0) return usage();
+
+    PopulationParams prm;
+    const char* color = nullptr;
+    if (!paramsFor(argv[1], count, seed, prm, color)) return usage();
+    if (const char* inner = option(argc, argv, "--inner", nullptr)) prm.innerRadius = std::atof(inner) * AU;
+    if (const char* outer = option(argc, argv, "--outer", nullptr)) prm.outerRadius = std::atof(outer) * AU;
+    if (prm.outerRadius <= prm.innerRadius) { std::fprintf(stderr, "--outer must exceed --inner\n"); return 2; }
+
+    std::vector<ScenarioBody> bodies;
+    if (const char* base = option(argc, argv, "--base", nullptr)) {
+        if (!readScenario(base, bodies)) { std::fprintf(stderr, "cannot load %s\n", base); return 1; }
+    }
+
+    // Центр популяции — самое массивное тело базы
+    if (prm.kind != PopulationKind::PlummerCluster) {
+        if (bodies.empty()) {
+            ScenarioBody sun;
+            sun.name = "Sun"; sun.color = "#ffff00";
+            sun.mass = SolarMass; sun.radius = 696340000.0;
+            bodies.push_back(sun);
+        }
+        const ScenarioBody* center = &bodies[0];
+        for (const auto& b : bodies) if (b.mass > center->mass) center = &b;
+        prm.centralMass = center->mass;
+        prm.centerPosition = center->position;
+        prm.centerVelocity = center->velocity;
+    }
+
+    auto t0 = Clock::now();
+    const GeneratedPopulation pop = generatePopulation(prm);
+    auto t1 = Clock::now();
+
+    const size_t offset = bodies.size();
+    bodies.resize(offset + pop.size());
+    const std::string prefix = populationName(prm.kind);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < pop.size(); ++i) {
+        ScenarioBody& b = bodies[offset + i];
+        b.name = prefix + " " + std::to_string(i + 1);
+        b.color = color;
+        b.mass = pop.masses[i];
+        b.radius = pop.radii[i];
+        b.position = pop.positions[i];
+        b.velocity = pop.velocities[i];
+    }
+
+    if (!writeScenario(argv[2], bodies)) { std::fprintf(stderr, "cannot write %s\n", argv[2]); return 1; }
+    auto t2 = Clock::now();
+    std::printf("%d bodies (%zu total): generate %.3f s, write %.3f s\n", pop.size(), bodies.size(),
+                seconds(t0, t1), seconds(t1, t2));
+    return 0;
+}
+
+bool identical(const GeneratedPopulation& a, const GeneratedPopulation& b) {
+    if (a.size() != b.size()) return false;
+    for (int i = 0; i < a.size(); ++i) {
+        if (a.masses[i] != b.masses[i] || a.positions[i] != b.positions[i] || a.velocities[i] != b.velocities[i])
+            return false;
+    }
+    return true;
+}
+
+int check(int argc, char** argv) {
+    const int count = std::atoi(option(argc, argv, "--count", "20000"));
+    bool ok = true;
+
+    for (const char* kind : {"asteroids", "kuiper", "disk", "plummer"}) {
+        PopulationParams prm;
+        const char* color = nullptr;
+        paramsFor(kind, count, 42, prm, color);
+
+        // Детерминизм: 1 поток против всех
+        const int threads = omp_get_max_threads();
+        omp_set_num_threads(1);
+        const GeneratedPopulation serial = generatePopulation(prm);
+        omp_set_num_threads(threads);
+        auto t0 = Clock::now();
+        const GeneratedPopulation parallel = generatePopulation(prm);
+        const double dt = seconds(t0, Clock::now());
+        const bool same = identical(serial, parallel);
+
+        // Физика: у кеплеровых популяций большая полуось в заданных пределах,
+        // у скопления Пламмера 2T/|W| ~ 1
+        double metric = 0.0;
+        bool physical = true;
+        const double G = NBodyEngine::G;
+        if (prm.kind == PopulationKind::PlummerCluster) {
+            double T = 0.0, W = 0.0;
+            const int n = parallel.size();
+            #pragma omp parallel for reduction(+:T, W) schedule(dynamic, 64)
+            for (int i = 0; i < n; ++i) {
+                T += 0.5 * parallel.masses[i] * parallel.velocities[i].squaredNorm();
+                for (int j = i + 1; j < n; ++j)
+                    W -= G * parallel.masses[i] * parallel.masses[j] / (parallel.positions[i] - parallel.positions[j]).norm();
+            }
+            metric = 2.0 * T / std::fabs(W);
+            physical = std::fabs(metric - 1.0) < 0.1;
+        } else {
+            double worst = 0.0;
+            for (int i = 0; i < parallel.size(); ++i) {
+                const double r = parallel.positions[i].norm();
+                const double v2 = parallel.velocities[i].squaredNorm();
+                const double mu = G * (prm.centralMass + parallel.masses[i]);
+                const double a = 1.0 / (2.0 / r - v2 / mu); // vis-viva
+                double lo = prm.innerRadius, hi = prm.outerRadius;
+                if (prm.kind == PopulationKind::KuiperBelt) { lo = std::min(lo, 0.98 * prm.resonantRadius); hi = std::max(hi, 1.02 * prm.resonantRadius); }
+                if (prm.kind == PopulationKind::ProtoplanetaryDisk) { lo *= 0.5; hi *= 1.5; } // Масса диска и дисперсия скоростей
+                if (!(a > lo && a < hi)) physical = false;
+                worst = std::max(worst, std::fabs(a - 0.5 * (lo + hi)) / (0.5 * (hi - lo)));
+            }
+            metric = worst;
+        }
+
+        std::printf("%-10s %8d bodies  %.3f s  deterministic: %s  %s %.3f%s\n", kind, parallel.size(), dt,
+                    same ? "yes" : "NO",
+                    prm.kind == PopulationKind::PlummerCluster ? "virial 2T/|W|" : "max |a - mid| / half-width",
+                    metric, physical ? "" : "  (out of range)");
+        ok = ok && same && physical;
+    }
+
+    if (!ok) { std::fprintf(stderr, "FAILED\n"); return 1; }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    if (std::strcmp(argv[1], "check") == 0) return check(argc, argv);
+    return generate(argc, argv);
+}
@@ -0,0 +1,224 @@
+// secular — вековая эволюция орбит сценария (Лаплас—Лагранж).
+//
+//   secular <scenario.json> [--years Y] [--samples K] [--csv out.csv]
+//   secular check [--years Y]
+//
+// Орбиты снимаются с начального состояния сценария; печатаются частоты
+// собственных мод и e, i всех тел через равные промежутки, по желанию
+// весь ряд в CSV. check сверяет вековое решение с прямым интегрированием
+// (RK4) модельной системы на доле векового периода, проверяет передачу
+// состояния обратно в N-body и меряет скорость на миллионе лет.
+
+#include "core/ScenarioFile.h"
+#include "core/SecularEvolution.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr double Year = 365.25 * 86400.0;
+constexpr double AU = 1.496e11;
+constexpr double SolarMass = 1.989e30;
+constexpr double Degree = 3.14159265358979323846 / 180.0;
+constexpr double ArcsecPerYear = Year / (Degree / 3600.0); // рад/с -> "/год
+
+const char* option(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 0; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    return fallback;
+}
+
+int usage() {
+    std::fprintf(stderr,
+        "usage:\n"
+        "  secular <scenario.json> [--years Y] [--samples K] [--csv out.csv]\n"
+        "  secular check [--years Y]\n");
+    return 2;
+}
+
+void printModes(const SecularEvolution& secular) {
+    std::printf("modes g, \"/yr:");
+    for (int m = 0; m < secular.eccentricityFrequencies().size(); ++m)
+        std::printf(" %.4f", secular.eccentricityFrequencies()(m) * ArcsecPerYear);
+    std::printf("\nmodes f, \"/yr:");
+    for (int m = 0; m < secular.inclinationFrequencies().size(); ++m)
+        std::printf(" %.4f", secular.inclinationFrequencies()(m) * ArcsecPerYear);
+    std::printf("\n");
+}
+
+int run(int argc, char** argv) {
+    if (argc < 2) return usage();
+    std::vector<ScenarioBody> scenario;
+    if (!readScenario(argv[1], scenario) || scenario.empty()) { std::fprintf(stderr, "cannot load %s\n", argv[1]); return 1; }
+
+    NBodyEngine engine;
+    for (const auto& b : scenario) engine.addBody(b.mass, b.position, b.velocity);
+    const std::vector<int> parents = scenarioParents(scenario);
+    for (int i = 0; i < (int)parents.size(); ++i)
+        if (parents[i] >= 0) engine.setParent(i, parents[i]);
+
+    const double years = std::atof(option(argc, argv, "--years", "1000000"));
+    const int samples = std::max(1, std::atoi(option(argc, argv, "--samples", "10")));
+
+    SecularEvolution secular;
+    if (!secular.initialize(engine)) { std::fprintf(stderr, "scenario has unbound or retrograde orbits\n"); return 1; }
+    printModes(secular);
+
+    FILE* csv = nullptr;
+    if (const char* path = option(argc, argv, "--csv", nullptr)) {
+        csv = std::fopen(path, "w");
+        if (!csv) { std::fprintf(stderr, "cannot write %s\n", path); return 1; }
+        std::fprintf(csv, "years,body,a_au,e,inc_deg,node_deg,perihelion_deg\n");
+    }
+
+    const auto t0 = Clock::now();
+    for (int s = 0; s <= samples; ++s) {
+        secular.advance(years * Year / samples * (s > 0));
+        std::printf("t = %.0f yr\n", secular.time() / Year);
+        for (int i = 0; i < (int)scenario.size(); ++i) {
+            const SecularEvolution::Elements el = secular.elements(i);
+            if (el.a == 0.0) continue; // Центральное тело
+            std::printf("  %-12s e %.5f  i %.4f deg\n", scenario[i].name.c_str(), el.e, el.inc / Degree);
+            if (csv) std::fprintf(csv, "%.1f,%s,%.9g,%.9g,%.9g,%.9g,%.9g\n", secular.time() / Year, scenario[i].name.c_str(),
+                                  el.a / AU, el.e, el.inc / Degree, el.node / Degree, el.perihelion / Degree);
+        }
+    }
+    if (csv) std::fclose(csv);
+
+    // Передача обратно в N-body на конечный момент
+    secular.writeState(engine);
+    std::printf("%.0f years in %.3f s\n", years, std::chrono::duration<double>(Clock::now() - t0).count());
+    return 0;
+}
+
+// Модельная система: звезда, две планеты (~100 масс Земли) вдали от резонансов
+// средних движений и частица снаружи. Вековые периоды ~2*10^4 лет — их заметная
+// доля доступна прямому счету; массы малы, чтобы поправки второго порядка по
+// массам (вне теории Лапласа—Лагранжа) не превышали допуска
+void buildCheckSystem(NBodyEngine& engine) {
+    const double mu = NBodyEngine::G * SolarMass;
+    Eigen::Vector3d r, v;
+    engine.addBody(SolarMass, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+    struct { double mass, a, e, inc, node, peri, M; } orbits[] = {
+        {3e-4 * SolarMass, 1.0 * AU, 0.05, 1.0 * Degree, 0.3, 1.0, 0.0},
+        {1.5e-4 * SolarMass, 2.0 * AU, 0.02, 2.5 * Degree, 2.0, 4.0, 2.0},
+        {0.0, 3.6 * AU, 0.01, 0.5 * Degree, 5.0, 1.5, 4.0},
+    };
+    for (const auto& o : orbits) {
+        scenario_gen::keplerToState(mu + NBodyEngine::G * o.mass, o.a, o.e, o.inc, o.node, o.peri, o.M, r, v);
+        engine.addBody(o.mass, r, v);
+    }
+    // Импульс звезды — в ноль суммарный
+    Eigen::Vector3d p = Eigen::Vector3d::Zero();
+    for (int i = 1; i < engine.size(); ++i) p += engine.masses[i] * engine.velocities[i];
+    engine.velocities[0] = -p / SolarMass;
+}
+
+// Оскулирующие e, i тела относительно звезды в плоскости Лапласа
+SecularEvolution::Elements osculating(const NBodyEngine& engine, int body, const Eigen::Matrix3d& toLaplace) {
+    SecularEvolution::Elements el;
+    SecularEvolution::stateToElements(NBodyEngine::G * (engine.masses[0] + engine.masses[body]),
+                                      toLaplace * (engine.positions[body] - engine.positions[0]),
+                                      toLaplace * (engine.velocities[body] - engine.velocities[0]), el);
+    return el;
+}
+
+int check(int argc, char** argv) {
+    const double years = std::atof(option(argc, argv, "--years", "5000"));
+    bool ok = true;
+
+    NBodyEngine direct;
+    direct.currentIntegrator = IntegratorType::RungeKutta4;
+    buildCheckSystem(direct);
+    SecularEvolution secular;
+    if (!secular.initialize(direct)) { std::fprintf(stderr, "FAILED: initialize\n"); return 1; }
+    printModes(secular);
+
+    // 1. Передача без эволюции воспроизводит исходное состояние
+    {
+        NBodyEngine copy;
+        buildCheckSystem(copy);
+        secular.writeState(copy);
+        double worst = 0.0;
+        for (int i = 0; i < copy.size(); ++i)
+            worst = std::max(worst, (copy.positions[i] - direct.positions[i]).norm());
+        const bool pass = worst < 1e-6 * AU;
+        std::printf("round trip: max |dr| %.3g m%s\n", worst, pass ? "" : "  (FAILED)");
+        ok = ok && pass;
+    }
+
+    // 2. Вековое решение против прямого интегрирования. Оскулирующие элементы
+    //    дрожат на короткопериодических членах ~m/M, поэтому сравниваются
+    //    средние за окно в несколько орбит внешней планеты
+    const Eigen::Vector3d L = [&]() {
+        Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+        for (int i = 0; i < direct.size(); ++i) sum += direct.masses[i] * direct.positions[i].cross(direct.velocities[i]);
+        return sum;
+    }();
+    const Eigen::Matrix3d toLaplace = Eigen::Quaterniond::FromTwoVectors(L.normalized(), Eigen::Vector3d::UnitZ()).toRotationMatrix();
+
+    // RK4 не симплектичен и медленно гасит эксцентриситеты; при 2 сутках
+    // (180 шагов на внутреннюю орбиту) это на порядок ниже допуска
+    const double dt = 2.0 * 86400.0;
+    const double window = 20.0 * Year;
+    const int windows = (int)(years * Year / window);
+    const int stepsPerWindow = (int)(window / dt);
+    double worstE = 0.0, worstI = 0.0, rangeE = 0.0, rangeI = 0.0;
+    std::vector<double> e0(direct.size()), i0(direct.size());
+    const auto t0 = Clock::now();
+    for (int w = 0; w < windows; ++w) {
+        std::vector<double> meanE(direct.size(), 0.0), meanI(direct.size(), 0.0);
+        for (int s = 0; s < stepsPerWindow; ++s) {
+            direct.step(dt);
+            for (int b = 1; b < direct.size(); ++b) {
+                const SecularEvolution::Elements el = osculating(direct, b, toLaplace);
+                meanE[b] += el.e / stepsPerWindow;
+                meanI[b] += el.inc / stepsPerWindow;
+            }
+        }
+        // Среднее за окно сравнивается с вековым решением в середине окна
+        secular.advance(w == 0 ? 0.5 * window : window);
+        for (int b = 1; b < direct.size(); ++b) {
+            const SecularEvolution::Elements el = secular.elements(b);
+            if (w == 0) { e0[b] = el.e; i0[b] = el.inc; }
+            rangeE = std::max(rangeE, std::fabs(el.e - e0[b]));
+            rangeI = std::max(rangeI, std::fabs(el.inc - i0[b]));
+            worstE = std::max(worstE, std::fabs(el.e - meanE[b]));
+            worstI = std::max(worstI, std::fabs(el.inc - meanI[b]));
+        }
+    }
+    const double directSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    // Погрешность теории — второй порядок по массам и e^2, т.е. малая доля размаха
+    // (наклоны планет в плоскости Лапласа почти постоянны, размах дает частица)
+    const bool pass = worstE < 0.1 * rangeE && worstI < 0.1 * rangeI;
+    std::printf("%.0f years vs RK4 (%.2f s): max |de| %.2e of range %.2e, max |di| %.2e of range %.2e deg%s\n",
+                years, directSeconds, worstE, rangeE, worstI / Degree, rangeI / Degree, pass ? "" : "  (FAILED)");
+    ok = ok && pass;
+
+    // 3. Миллион лет с передачей состояния каждые 1000 лет
+    {
+        const auto t1 = Clock::now();
+        for (int k = 0; k < 1000; ++k) {
+            secular.advance(1000.0 * Year);
+            secular.writeState(direct);
+        }
+        const double s = std::chrono::duration<double>(Clock::now() - t1).count();
+        std::printf("1 Myr (1000 hand-backs): %.4f s\n", s);
+    }
+
+    if (!ok) { std::fprintf(stderr, "FAILED\n"); return 1; }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    if (std::strcmp(argv[1], "check") == 0) return check(argc, argv);
+    return run(argc, argv);
+}
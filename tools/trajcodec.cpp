@@ -0,0 +1,223 @@
+// trajcodec — кодер/декодер траекторий .strj и бенчмарк сжатия.
+//
+//   trajcodec encode <in.f64> <out.strj> --bodies N [--max-error M] [--chunk F]
+//   trajcodec decode <in.strj> <out.f64>
+//   trajcodec info   <in.strj>
+//   trajcodec bench  <scenario.json | run.strj> [--steps S] [--dt SEC] [--max-error M1,M2,...]
+//
+// *.f64 — сырые кадры: double[N][3] подряд (little-endian), время = номер кадра.
+// bench на сценарии интегрирует его ядром и кодирует каждый шаг "на лету";
+// на записи .strj (из GUI) — перекодирует реальный прогон с другими допусками.
+
+#include "core/NBodyEngine.h"
+#include "core/ScenarioFile.h"
+#include "core/TrajectoryCodec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double>(b - a).count();
+}
+
+const char* option(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 0; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    return fallback;
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int usage() {
+    std::fprintf(stderr,
+        "usage:\n"
+        "  trajcodec encode <in.f64> <out.strj> --bodies N [--max-error M] [--chunk F]\n"
+        "  trajcodec decode <in.strj> <out.f64>\n"
+        "  trajcodec info   <in.strj>\n"
+        "  trajcodec bench  <scenario.json | run.strj> [--steps S] [--dt SEC] [--max-error M1,M2,...]\n");
+    return 2;
+}
+
+int encodeFile(int argc, char** argv) {
+    if (argc < 4) return usage();
+    const int bodies = std::atoi(option(argc, argv, "--bodies", "0"));
+    const double maxError = std::atof(option(argc, argv, "--max-error", "1000"));
+    const int chunk = std::atoi(option(argc, argv, "--chunk", "256"));
+    if (bodies <= 0 || maxError <= 0.0 || chunk <= 0) return usage();
+
+    std::ifstream in(argv[2], std::ios::binary);
+    std::ofstream out(argv[3], std::ios::binary);
+    if (!in || !out) { std::fprintf(stderr, "cannot open files\n"); return 1; }
+
+    std::vector<double> frame(3 * (size_t)bodies);
+    TrajectoryEncoder encoder(out, bodies, maxError, chunk);
+    uint64_t frames = 0;
+    while (in.read(reinterpret_cast<char*>(frame.data()), frame.size() * sizeof(double))) {
+        if (!encoder.addFrame((double)frames, frame.data())) {
+            std::fprintf(stderr, "frame %llu: coordinate out of range for max-error %g\n", (unsigned long long)frames, maxError);
+            return 1;
+        }
+        ++frames;
+    }
+    encoder.finish();
+    std::printf("%llu frames, %llu bytes\n", (unsigned long long)frames, (unsigned long long)encoder.bytesWritten());
+    return 0;
+}
+
+int decodeFile(int argc, char** argv) {
+    if (argc < 4) return usage();
+    std::ifstream in(argv[2], std::ios::binary);
+    TrajectoryDecoder decoder(in);
+    if (!decoder.isValid()) { std::fprintf(stderr, "not a valid .strj file\n"); return 1; }
+
+    std::ofstream out(argv[3], std::ios::binary);
+    std::vector<double> times, positions;
+    for (int c = 0; c < decoder.chunkCount(); ++c) {
+        if (!decoder.decodeChunk(c, times, positions)) { std::fprintf(stderr, "chunk %d is corrupt\n", c); return 1; }
+        out.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(double));
+    }
+    return 0;
+}
+
+int info(int argc, char** argv) {
+    if (argc < 3) return usage();
+    std::ifstream in(argv[2], std::ios::binary);
+    TrajectoryDecoder decoder(in);
+    if (!decoder.isValid()) { std::fprintf(stderr, "not a valid .strj file\n"); return 1; }
+    std::printf("bodies %d, frames %llu, chunks %d, max error %g m\n", decoder.bodyCount(),
+                (unsigned long long)decoder.frameCount(), decoder.chunkCount(), decoder.maxError());
+    return 0;
+}
+
+// Кадры реального прогона: интегрируем сценарий или читаем запись
+bool loadRun(int argc, char** argv, int& bodies, std::vector<double>& times, std::vector<double>& frames, double& integrateSeconds) {
+    const std::string path = argv[2];
+    integrateSeconds = 0.0;
+
+    if (endsWith(path, ".strj")) {
+        std::ifstream in(path, std::ios::binary);
+        TrajectoryDecoder decoder(in);
+        if (!decoder.isValid()) return false;
+        bodies = decoder.bodyCount();
+        std::vector<double> t, p;
+        for (int c = 0; c < decoder.chunkCount(); ++c) {
+            if (!decoder.decodeChunk(c, t, p)) return false;
+            times.insert(times.end(), t.begin(), t.end());
+            frames.insert(frames.end(), p.begin(), p.end());
+        }
+        return true;
+    }
+
+    std::vector<ScenarioBody> scenario;
+    if (!readScenario(path, scenario) || scenario.empty()) return false;
+    const int steps = std::atoi(option(argc, argv, "--steps", "10000"));
+    const double dt = std::atof(option(argc, argv, "--dt", "86400"));
+
+    NBodyEngine engine;
+    for (const auto& b : scenario) engine.addBody(b.mass, b.position, b.velocity);
+    const std::vector<int> parents = scenarioParents(scenario);
+    for (int i = 0; i < (int)parents.size(); ++i) {
+        if (parents[i] >= 0) engine.setParent(i, parents[i]);
+    }
+    bodies = engine.size();
+    frames.reserve((size_t)steps * bodies * 3);
+
+    auto t0 = Clock::now();
+    for (int s = 0; s < steps; ++s) {
+        engine.step(dt);
+        times.push_back(engine.time);
+        const double* p = engine.positions.data()->data();
+        frames.insert(frames.end(), p, p + 3 * (size_t)bodies);
+    }
+    integrateSeconds = seconds(t0, Clock::now());
+    return true;
+}
+
+int bench(int argc, char** argv) {
+    if (argc < 3) return usage();
+    int bodies = 0;
+    std::vector<double> times, frames;
+    double integrateSeconds = 0.0;
+    if (!loadRun(argc, argv, bodies, times, frames, integrateSeconds)) {
+        std::fprintf(stderr, "cannot load %s\n", argv[2]);
+        return 1;
+    }
+
+    const size_t frameCount = times.size();
+    const size_t stride = 3 * (size_t)bodies;
+    const double rawBytes = (double)frames.size() * sizeof(double);
+    std::printf("%s: %d bodies x %zu frames, raw %.1f MB\n", argv[2], bodies, frameCount, rawBytes / 1e6);
+    if (integrateSeconds > 0.0)
+        std::printf("integration: %.3f s (%.0f steps/s)\n", integrateSeconds, frameCount / integrateSeconds);
+
+    std::printf("%12s %10s %14s %14s %14s %14s\n", "max err, m", "ratio", "bits/coord", "encode MB/s", "decode MB/s", "actual err, m");
+
+    std::stringstream list(option(argc, argv, "--max-error", "1,100,1000,10000"));
+    std::string token;
+    bool boundHolds = true;
+    while (std::getline(list, token, ',')) {
+        const double maxError = std::atof(token.c_str());
+        if (maxError <= 0.0) continue;
+
+        std::stringstream stream;
+        auto t0 = Clock::now();
+        {
+            TrajectoryEncoder encoder(stream, bodies, maxError);
+            for (size_t f = 0; f < frameCount; ++f) encoder.addFrame(times[f], frames.data() + f * stride);
+        }
+        const double encodeSeconds = seconds(t0, Clock::now());
+        const double packedBytes = (double)stream.str().size();
+
+        // Декодирование и проверка границы ошибки
+        TrajectoryDecoder decoder(stream);
+        std::vector<double> t, p;
+        double worst = 0.0;
+        size_t frame = 0;
+        double decodeSeconds = 0.0;
+        for (int c = 0; c < decoder.chunkCount(); ++c) {
+            auto d0 = Clock::now();
+            decoder.decodeChunk(c, t, p);
+            decodeSeconds += seconds(d0, Clock::now());
+            for (size_t i = 0; i < p.size(); i += 3) {
+                const double* ref = frames.data() + frame * stride + i;
+                double dx = p[i] - ref[0], dy = p[i + 1] - ref[1], dz = p[i + 2] - ref[2];
+                worst = std::max(worst, std::sqrt(dx * dx + dy * dy + dz * dz));
+            }
+            frame += t.size();
+        }
+
+        std::printf("%12g %10.2f %14.2f %14.1f %14.1f %14.3f\n", maxError, rawBytes / packedBytes,
+                    packedBytes * 8.0 / frames.size(), rawBytes / 1e6 / encodeSeconds,
+                    rawBytes / 1e6 / decodeSeconds, worst);
+        if (worst > maxError * (1.0 + 1e-9)) boundHolds = false;
+    }
+
+    if (!boundHolds) {
+        std::fprintf(stderr, "FAILED: reconstruction error exceeds the requested bound\n");
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    const std::string mode = argv[1];
+    if (mode == "encode") return encodeFile(argc, argv);
+    if (mode == "decode") return decodeFile(argc, argv);
+    if (mode == "info") return info(argc, argv);
+    if (mode == "bench") return bench(argc, argv);
+    return usage();
+}